@@ -441,7 +441,7 @@ namespace filez
                const std::size_t equals = view.find( '=' );
 
                if( equals == std::string_view::npos ) {
-                  call( arg );
+                  call( view );
                }
                else if( view.size() <= ( equals + 1 ) ) {
                   call( view.substr( 0, equals ), std::string_view() );
@@ -0,0 +1,86 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#include <filesystem>
+#include <vector>
+
+#include "arguments.hpp"
+#include "benchmark.hpp"
+#include "file_info_vector.hpp"
+#include "hash_args.hpp"
+#include "macros.hpp"
+
+bool canonical = true;
+bool recursive = true;
+
+bool order = false;
+bool algorithms = false;
+bool stream = false;
+bool scan = false;
+
+std::vector< std::filesystem::path > paths;
+
+int main( int argc, char** argv )
+{
+   filez::arguments args( paths );
+
+   args.add_bool( 'C', canonical );
+   args.add_bool( 'R', recursive );
+
+   args.add_bool( 'o', order );
+   args.add_bool( 'a', algorithms );
+   args.add_bool( 's', stream );
+   args.add_bool( 'd', scan );
+
+   filez::add_hash_args( args );
+
+   if( ( !args.parse_nothrow( argc, argv ) ) || paths.empty() ) {
+      FILEZ_STDERR( "Usage: " << argv[ 0 ] << " [OPTION]... DIRECTORY [DIRECTORY]..." );
+      FILEZ_STDERR( "  Measures the hashing throughput for the files in one or more directories." );
+      FILEZ_STDERR( "    -o   Compares hashing in path, inode and physical order (default)." );
+      FILEZ_STDERR( "    -a   Compares the hash algorithms sha256, blake3 and xxh3." );
+      FILEZ_STDERR( "    -s   Compares hashing with mmap() and with --stream." );
+      FILEZ_STDERR( "    -d   Compares scanning the directories in readdir and in inode order." );
+      FILEZ_STDERR( "  Additional options are..." );
+      FILEZ_STDERR( "    -R   to change to non-recursive scanning." );
+      FILEZ_STDERR( "    -C   to disable normalising the given paths." );
+      filez::print_hash_args_usage();
+      FILEZ_STDERR( "  For -o and -s the files are dropped from the page cache before every run, as far as" );
+      FILEZ_STDERR( "    possible without root privileges; for truly cold runs as root use" );
+      FILEZ_STDERR( "    'sync; echo 3 > /proc/sys/vm/drop_caches' on Linux before starting." );
+      FILEZ_STDERR( "  For -d the metadata caches are dropped before every run when running as root on Linux." );
+      return 1;
+   }
+   for( auto& path : paths ) {
+      if( canonical ) {
+         path = std::filesystem::canonical( path );
+      }
+   }
+   const bool hashing = order || algorithms || stream;  // Otherwise -o is the default, unless only -d was given.
+
+   if( scan ) {
+      // Before the scan below warms the caches.
+      filez::benchmark_scan( paths, recursive );
+
+      if( !hashing ) {
+         return 0;
+      }
+   }
+   filez::file_info_vector list;
+
+   for( const auto& path : paths ) {
+      const auto part = recursive ? filez::make_full_file_info_vector( path ) : filez::make_file_info_vector( path );
+      list.insert( list.end(), part.begin(), part.end() );
+   }
+   const auto files = filez::benchmark_files( list );
+
+   if( order || !hashing ) {
+      filez::benchmark_order( files );
+   }
+   if( algorithms ) {
+      filez::benchmark_algorithms( files );
+   }
+   if( stream ) {
+      filez::benchmark_stream( files );
+   }
+   return 0;
+}
@@ -0,0 +1,194 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "directory_scan.hpp"
+#include "file_info.hpp"
+#include "file_info_vector.hpp"
+#include "file_mmap.hpp"
+#include "file_open.hpp"
+#include "file_stream.hpp"
+#include "data_hash.hpp"
+#include "hash_args.hpp"
+#include "hash_file.hpp"
+#include "hash_schedule.hpp"
+#include "macros.hpp"
+#include "system.hpp"
+
+namespace filez
+{
+   // Without root privileges this is the best we can do to get a cold cache; it doesn't
+   // drop the metadata and it can't drop pages that are mapped by other processes.
+
+   inline void drop_page_cache( const std::vector< file_info* >& files )
+   {
+      for( file_info* fi : files ) {
+         const int fd = ::open( fi->path().c_str(), O_RDONLY );
+
+         if( fd >= 0 ) {
+#if defined( POSIX_FADV_DONTNEED )
+            (void)::posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+#endif
+            ::close( fd );
+         }
+      }
+   }
+
+   template< typename F >
+   void benchmark_time( const std::string_view name, const std::vector< file_info* >& files, F&& f )
+   {
+      std::size_t bytes = 0;
+      const auto start = std::chrono::steady_clock::now();
+
+      for( file_info* fi : files ) {
+         bytes += fi->stat().size();
+         f( *fi );
+      }
+      const std::chrono::duration< double > seconds = std::chrono::steady_clock::now() - start;
+
+      FILEZ_STDOUT( name << ": " << files.size() << " files, " << bytes << " bytes, " << seconds.count() << " seconds, " << ( double( bytes ) / seconds.count() / 1e6 ) << " MB/s" );
+   }
+
+   template< typename F >
+   void benchmark_run( const std::string_view name, const std::vector< file_info* >& files, F&& f )
+   {
+      drop_page_cache( files );
+      benchmark_time( name, files, std::forward< F >( f ) );
+   }
+
+   // Bypasses the hash caches since we want to hash the same files more than once.
+
+   inline void benchmark_hash_total( file_info& fi )
+   {
+      if( fi.stat().size() > 0 ) {
+         const file_open open( fi.path() );
+         const file_mmap mmap( fi.path(), open, fi.stat() );
+         (void)hash_total_impl( mmap, mmap.size() );
+      }
+   }
+
+   inline void benchmark_hash_stream( file_info& fi )
+   {
+      if( fi.stat().size() > 0 ) {
+         file_stream stream( fi.path(), fi.stat(), global_hash_args().chunk_size, global_hash_args().buffers );
+         (void)hash_total_impl( stream, stream.size() );
+      }
+   }
+
+   template< typename H >
+   void benchmark_hash_with( file_info& fi, const H& h )
+   {
+      if( fi.stat().size() > 0 ) {
+         const file_open open( fi.path() );
+         const file_mmap mmap( fi.path(), open, fi.stat() );
+         basic_data_hash< H > hash( h );
+         hash.update( mmap.data(), mmap.size() );
+         (void)hash.result( 'T' );
+      }
+   }
+
+   [[nodiscard]] inline std::vector< file_info* > benchmark_files( const file_info_vector& list )
+   {
+      std::vector< file_info* > result;
+
+      for( const auto& sp : list ) {
+         if( sp->stat().is_file() ) {
+            result.emplace_back( sp.get() );
+         }
+      }
+      return result;
+   }
+
+   inline void benchmark_order( const std::vector< file_info* >& files )
+   {
+      std::vector< file_info* > path_order = files;
+      std::sort( path_order.begin(), path_order.end(), []( file_info* l, file_info* r ){ return l->path() < r->path(); } );
+
+      benchmark_run( "path order", path_order, benchmark_hash_total );
+      benchmark_run( "inode order", hash_order( files, false, false ), benchmark_hash_total );
+      benchmark_run( "physical order", hash_order( files, false, true ), benchmark_hash_total );
+   }
+
+   inline void benchmark_stream( const std::vector< file_info* >& files )
+   {
+      benchmark_run( "mmap", files, benchmark_hash_total );
+      benchmark_run( "stream with " + std::to_string( std::max< std::size_t >( global_hash_args().buffers, 2 ) ) + " buffers of " + std::to_string( rounded_up_to_pagesize( global_hash_args().chunk_size ) ) + " bytes", files, benchmark_hash_stream );
+   }
+
+   // The directory scans need the dentry and inode caches to be dropped, which is only
+   // possible as root on Linux; otherwise they only show the CPU overhead of the orders.
+
+   [[nodiscard]] inline bool drop_metadata_cache()
+   {
+#if defined( __linux__ )
+      if( ::geteuid() == 0 ) {
+         ::sync();
+
+         if( const int fd = ::open( "/proc/sys/vm/drop_caches", O_WRONLY ); fd >= 0 ) {
+            const bool dropped = ( ::write( fd, "2", 1 ) == 1 );
+            ::close( fd );
+            return dropped;
+         }
+      }
+#endif
+      return false;
+   }
+
+   template< typename F >
+   void benchmark_scan_with( const std::string_view name, const std::vector< std::filesystem::path >& paths, F&& f )
+   {
+      const bool cold = drop_metadata_cache();
+      const auto start = std::chrono::steady_clock::now();
+
+      std::size_t entries = 0;
+
+      for( const auto& path : paths ) {
+         entries += f( path ).size();
+      }
+      const std::chrono::duration< double > seconds = std::chrono::steady_clock::now() - start;
+
+      FILEZ_STDOUT( name << ": " << entries << " entries, " << seconds.count() << " seconds" << ( cold ? ", cold cache" : ", warm cache" ) );
+   }
+
+   inline void benchmark_scan( const std::vector< std::filesystem::path >& paths, const bool recursive )
+   {
+      benchmark_scan_with( "readdir order", paths, [ = ]( const std::filesystem::path& path ){
+         file_info_vector result = recursive ? make_full_file_info_vector( path ) : make_file_info_vector( path );
+
+         for( const auto& sp : result ) {
+            (void)sp->stat();
+         }
+         return result;
+      } );
+      benchmark_scan_with( "inode order", paths, [ = ]( const std::filesystem::path& path ){ return make_inode_ordered_file_info_vector( path, recursive ); } );
+   }
+
+   // The algorithms are compared with a warm page cache to measure the hashing rather than the I/O.
+
+   inline void benchmark_algorithms( const std::vector< file_info* >& files )
+   {
+      const unsigned threads = std::max( 1U, std::thread::hardware_concurrency() );
+
+      benchmark_time( "warm up", files, []( file_info& fi ){ benchmark_hash_with( fi, xxh3() ); } );
+      benchmark_time( "sha256", files, []( file_info& fi ){ benchmark_hash_with( fi, sha256() ); } );
+      benchmark_time( "blake3", files, []( file_info& fi ){ benchmark_hash_with( fi, blake3() ); } );
+
+      if( threads > 1 ) {
+         benchmark_time( "blake3 with " + std::to_string( threads ) + " threads", files, [ = ]( file_info& fi ){ benchmark_hash_with( fi, blake3( threads ) ); } );
+      }
+      benchmark_time( "xxh3", files, []( file_info& fi ){ benchmark_hash_with( fi, xxh3() ); } );
+   }
+
+}  // namespace filez
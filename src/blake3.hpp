@@ -0,0 +1,65 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace filez
+{
+   constexpr std::size_t blake3_hash_size = 256 / 8;
+   constexpr std::size_t blake3_block_size = 64;
+   constexpr std::size_t blake3_chunk_size = 1024;
+
+   // Portable (no SIMD) implementation of the unkeyed BLAKE3 hash following the reference
+   // implementation, with the addition that large inputs given to a single update() are
+   // split into subtrees that are hashed on up to the given number of threads in parallel.
+
+   class blake3
+   {
+   public:
+      explicit blake3( const unsigned threads = 1 ) noexcept
+         : m_threads( threads ? threads : 1 )
+      {}
+
+      void update( const void* data, const std::size_t size )
+      {
+         updatev( static_cast< const std::uint8_t* >( data ), size );
+      }
+
+      void finalise( void* hash )
+      {
+         // hash MUST point to blake3_hash_size writable bytes!
+
+         finalisev( static_cast< std::uint8_t* >( hash ) );
+      }
+
+      struct chunk_state
+      {
+         std::uint32_t cv[ 8 ];
+         std::uint64_t counter = 0;
+         std::uint8_t block[ blake3_block_size ];
+         std::uint8_t block_len = 0;
+         std::uint8_t blocks_compressed = 0;
+
+         explicit chunk_state( const std::uint64_t chunk_counter ) noexcept;
+
+         [[nodiscard]] std::size_t length() const noexcept;
+         void update( const std::uint8_t*, std::size_t ) noexcept;
+      };
+
+   private:
+      unsigned m_threads;
+      chunk_state m_chunk = chunk_state( 0 );
+      std::uint32_t m_stack[ 54 ][ 8 ];
+      std::uint8_t m_stack_len = 0;
+
+      void push_cv( const std::uint32_t*, std::uint64_t );
+      void merge_cv_stack( std::uint64_t );
+      void updatev( const std::uint8_t*, std::size_t );
+      void finalisev( std::uint8_t* );
+   };
+
+}  // namespace filez
+
+#include "blake3_impl.hpp"
@@ -0,0 +1,257 @@
+//  Implementation of the BLAKE3 hash function.
+//  Follows the reference implementation by Jack O'Connor, Jean-Philippe Aumasson,
+//  Samuel Neves and Zooko Wilcox-O'Hearn released into the public domain (CC0).
+//  Adapted to C++ by Dr. Colin Hirsch retaining Public Domain license.
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <system_error>
+
+#include "macros.hpp"
+
+namespace filez
+{
+   constexpr std::uint32_t blake3_IV_impl[ 8 ] = {
+      0x6A09E667UL, 0xBB67AE85UL, 0x3C6EF372UL, 0xA54FF53AUL, 0x510E527FUL, 0x9B05688CUL, 0x1F83D9ABUL, 0x5BE0CD19UL
+   };
+
+   constexpr unsigned blake3_permutation_impl[ 16 ] = { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 };
+
+   constexpr std::uint32_t blake3_chunk_start = 1 << 0;
+   constexpr std::uint32_t blake3_chunk_end = 1 << 1;
+   constexpr std::uint32_t blake3_parent = 1 << 2;
+   constexpr std::uint32_t blake3_root = 1 << 3;
+
+   // Subtrees smaller than this are not worth starting another thread for.
+
+   constexpr std::size_t blake3_parallel_min = 256 * 1024;
+
+   inline void blake3_g_impl( std::uint32_t* s, const unsigned a, const unsigned b, const unsigned c, const unsigned d, const std::uint32_t x, const std::uint32_t y ) noexcept
+   {
+      s[ a ] = s[ a ] + s[ b ] + x;
+      s[ d ] = std::rotr( s[ d ] ^ s[ a ], 16 );
+      s[ c ] = s[ c ] + s[ d ];
+      s[ b ] = std::rotr( s[ b ] ^ s[ c ], 12 );
+      s[ a ] = s[ a ] + s[ b ] + y;
+      s[ d ] = std::rotr( s[ d ] ^ s[ a ], 8 );
+      s[ c ] = s[ c ] + s[ d ];
+      s[ b ] = std::rotr( s[ b ] ^ s[ c ], 7 );
+   }
+
+   inline void blake3_round_impl( std::uint32_t* s, const std::uint32_t* m ) noexcept
+   {
+      blake3_g_impl( s, 0, 4, 8, 12, m[ 0 ], m[ 1 ] );
+      blake3_g_impl( s, 1, 5, 9, 13, m[ 2 ], m[ 3 ] );
+      blake3_g_impl( s, 2, 6, 10, 14, m[ 4 ], m[ 5 ] );
+      blake3_g_impl( s, 3, 7, 11, 15, m[ 6 ], m[ 7 ] );
+      blake3_g_impl( s, 0, 5, 10, 15, m[ 8 ], m[ 9 ] );
+      blake3_g_impl( s, 1, 6, 11, 12, m[ 10 ], m[ 11 ] );
+      blake3_g_impl( s, 2, 7, 8, 13, m[ 12 ], m[ 13 ] );
+      blake3_g_impl( s, 3, 4, 9, 14, m[ 14 ], m[ 15 ] );
+   }
+
+   inline void blake3_words_impl( std::uint32_t* words, const std::uint8_t* bytes ) noexcept
+   {
+      for( unsigned i = 0; i < 16; ++i ) {
+         words[ i ] = std::uint32_t( bytes[ 4 * i ] ) | ( std::uint32_t( bytes[ 4 * i + 1 ] ) << 8 ) | ( std::uint32_t( bytes[ 4 * i + 2 ] ) << 16 ) | ( std::uint32_t( bytes[ 4 * i + 3 ] ) << 24 );
+      }
+   }
+
+   inline void blake3_compress_impl( std::uint32_t* out, const std::uint32_t* cv, const std::uint8_t* block, const std::uint64_t counter, const std::uint32_t block_len, const std::uint32_t flags ) noexcept
+   {
+      std::uint32_t m[ 16 ];
+      blake3_words_impl( m, block );
+
+      std::uint32_t s[ 16 ] = {
+         cv[ 0 ], cv[ 1 ], cv[ 2 ], cv[ 3 ], cv[ 4 ], cv[ 5 ], cv[ 6 ], cv[ 7 ],
+         blake3_IV_impl[ 0 ], blake3_IV_impl[ 1 ], blake3_IV_impl[ 2 ], blake3_IV_impl[ 3 ],
+         std::uint32_t( counter ), std::uint32_t( counter >> 32 ), block_len, flags
+      };
+      for( unsigned r = 0; r < 7; ++r ) {
+         blake3_round_impl( s, m );
+
+         if( r < 6 ) {
+            std::uint32_t t[ 16 ];
+
+            for( unsigned i = 0; i < 16; ++i ) {
+               t[ i ] = m[ blake3_permutation_impl[ i ] ];
+            }
+            std::memcpy( m, t, sizeof( m ) );
+         }
+      }
+      for( unsigned i = 0; i < 8; ++i ) {
+         out[ i ] = s[ i ] ^ s[ i + 8 ];
+      }
+   }
+
+   inline void blake3_parent_cv_impl( std::uint32_t* out, const std::uint32_t* left, const std::uint32_t* right, const std::uint32_t flags ) noexcept
+   {
+      std::uint8_t block[ blake3_block_size ];
+
+      for( unsigned i = 0; i < 8; ++i ) {
+         for( unsigned j = 0; j < 4; ++j ) {
+            block[ 4 * i + j ] = std::uint8_t( left[ i ] >> ( 8 * j ) );
+            block[ 32 + 4 * i + j ] = std::uint8_t( right[ i ] >> ( 8 * j ) );
+         }
+      }
+      blake3_compress_impl( out, blake3_IV_impl, block, 0, blake3_block_size, blake3_parent | flags );
+   }
+
+   inline blake3::chunk_state::chunk_state( const std::uint64_t chunk_counter ) noexcept
+      : counter( chunk_counter )
+   {
+      std::memcpy( cv, blake3_IV_impl, sizeof( cv ) );
+      std::memset( block, 0, sizeof( block ) );
+   }
+
+   inline std::size_t blake3::chunk_state::length() const noexcept
+   {
+      return blake3_block_size * blocks_compressed + block_len;
+   }
+
+   inline void blake3::chunk_state::update( const std::uint8_t* data, std::size_t size ) noexcept
+   {
+      while( size > 0 ) {
+         if( block_len == blake3_block_size ) {
+            blake3_compress_impl( cv, cv, block, counter, blake3_block_size, blocks_compressed ? 0 : blake3_chunk_start );
+            ++blocks_compressed;
+            std::memset( block, 0, sizeof( block ) );
+            block_len = 0;
+         }
+         const std::size_t n = std::min( size, blake3_block_size - block_len );
+         std::memcpy( block + block_len, data, n );
+         block_len += n;
+         data += n;
+         size -= n;
+      }
+   }
+
+   // Computes the chaining value for the output of the chunk, the caller ORs in the root flag where appropriate.
+
+   inline void blake3_chunk_output_impl( std::uint32_t* out, const blake3::chunk_state& chunk, const std::uint32_t flags ) noexcept
+   {
+      const std::uint32_t start = chunk.blocks_compressed ? 0 : blake3_chunk_start;
+      blake3_compress_impl( out, chunk.cv, chunk.block, chunk.counter, chunk.block_len, start | blake3_chunk_end | flags );
+   }
+
+   // Hashes a complete (non-root) subtree of 2^n chunks into its chaining value,
+   // recursively splitting it into two halves, potentially on multiple threads.
+
+   inline void blake3_subtree_impl( std::uint32_t* out, const std::uint8_t* data, const std::size_t size, const std::uint64_t counter, const unsigned threads )
+   {
+      if( size <= blake3_chunk_size ) {
+         blake3::chunk_state chunk( counter );
+         chunk.update( data, size );
+         blake3_chunk_output_impl( out, chunk, 0 );
+         return;
+      }
+      const std::size_t half = size / 2;
+      const std::uint64_t right_counter = counter + half / blake3_chunk_size;
+
+      std::uint32_t left[ 8 ];
+      std::uint32_t right[ 8 ];
+
+      std::future< void > future;
+
+      if( ( threads > 1 ) && ( half >= blake3_parallel_min ) ) {
+         try {
+            future = std::async( std::launch::async, [ & ]() { blake3_subtree_impl( left, data, half, counter, threads / 2 ); } );
+         }
+         catch( const std::system_error& ) {
+            // Not being able to start another thread is not fatal, we just do it ourselves.
+         }
+      }
+      if( future.valid() ) {
+         blake3_subtree_impl( right, data + half, size - half, right_counter, threads - threads / 2 );
+         future.get();
+      }
+      else {
+         blake3_subtree_impl( left, data, half, counter, 1 );
+         blake3_subtree_impl( right, data + half, size - half, right_counter, 1 );
+      }
+      blake3_parent_cv_impl( out, left, right, 0 );
+   }
+
+   inline void blake3::merge_cv_stack( const std::uint64_t total_chunks )
+   {
+      const unsigned post_merge_stack_len = std::popcount( total_chunks );
+
+      while( m_stack_len > post_merge_stack_len ) {
+         blake3_parent_cv_impl( m_stack[ m_stack_len - 2 ], m_stack[ m_stack_len - 2 ], m_stack[ m_stack_len - 1 ], 0 );
+         --m_stack_len;
+      }
+   }
+
+   inline void blake3::push_cv( const std::uint32_t* cv, const std::uint64_t chunk_counter )
+   {
+      merge_cv_stack( chunk_counter );
+      std::memcpy( m_stack[ m_stack_len++ ], cv, sizeof( m_stack[ 0 ] ) );
+   }
+
+   inline void blake3::updatev( const std::uint8_t* data, std::size_t size )
+   {
+      // First complete the current chunk; it is only finalised when more data follows.
+
+      if( m_chunk.length() > 0 ) {
+         const std::size_t n = std::min( size, blake3_chunk_size - m_chunk.length() );
+         m_chunk.update( data, n );
+         data += n;
+         size -= n;
+
+         if( size == 0 ) {
+            return;
+         }
+         std::uint32_t cv[ 8 ];
+         blake3_chunk_output_impl( cv, m_chunk, 0 );
+         push_cv( cv, m_chunk.counter );
+         m_chunk = chunk_state( m_chunk.counter + 1 );
+      }
+      // Then hash the largest possible aligned subtrees while keeping at least one
+      // byte for the chunk state, which is always the last one, and could be the root.
+
+      while( size > blake3_chunk_size ) {
+         std::size_t subtree = std::bit_floor( size - 1 );
+         const std::uint64_t count = m_chunk.counter * blake3_chunk_size;
+
+         while( ( ( subtree - 1 ) & count ) != 0 ) {
+            subtree /= 2;
+         }
+         std::uint32_t cv[ 8 ];
+         blake3_subtree_impl( cv, data, subtree, m_chunk.counter, m_threads );
+         push_cv( cv, m_chunk.counter );
+         m_chunk = chunk_state( m_chunk.counter + std::max( std::size_t( 1 ), subtree / blake3_chunk_size ) );
+         data += subtree;
+         size -= subtree;
+      }
+      m_chunk.update( data, size );
+      merge_cv_stack( m_chunk.counter );
+   }
+
+   inline void blake3::finalisev( std::uint8_t* digest )
+   {
+      std::uint32_t out[ 8 ];
+
+      if( m_stack_len == 0 ) {
+         blake3_chunk_output_impl( out, m_chunk, blake3_root );
+      }
+      else {
+         std::uint32_t cv[ 8 ];
+         blake3_chunk_output_impl( cv, m_chunk, 0 );
+
+         for( unsigned i = m_stack_len; i > 0; --i ) {
+            blake3_parent_cv_impl( ( i == 1 ) ? out : cv, m_stack[ i - 1 ], cv, ( i == 1 ) ? blake3_root : 0 );
+         }
+      }
+      for( unsigned i = 0; i < 8; ++i ) {
+         for( unsigned j = 0; j < 4; ++j ) {
+            digest[ 4 * i + j ] = std::uint8_t( out[ i ] >> ( 8 * j ) );
+         }
+      }
+   }
+
+}  // namespace filez
@@ -3,29 +3,65 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
+#include "blake3.hpp"
 #include "hexdump.hpp"
 #include "macros.hpp"
 #include "sha256.hpp"
+#include "xxh3.hpp"
 
 namespace filez
 {
-   class data_hash
+   // The tag is inserted after the scope character of a result to ensure that
+   // hashes made with different algorithms never compare equal; SHA-256 has
+   // no tag to remain compatible with the hashes from previous versions.
+
+   template< typename H >
+   struct hash_traits;
+
+   template<>
+   struct hash_traits< sha256 >
+   {
+      static constexpr std::size_t size = sha256_hash_size;
+      static constexpr char tag = 0;
+   };
+
+   template<>
+   struct hash_traits< blake3 >
+   {
+      static constexpr std::size_t size = blake3_hash_size;
+      static constexpr char tag = 'b';
+   };
+
+   template<>
+   struct hash_traits< xxh3 >
+   {
+      static constexpr std::size_t size = xxh3_hash_size;
+      static constexpr char tag = 'x';
+   };
+
+   template< typename H >
+   class basic_data_hash
    {
    public:
-      data_hash() noexcept = default;
+      basic_data_hash() noexcept = default;
+
+      explicit basic_data_hash( const H& hash ) noexcept
+         : m_hash( hash )
+      {}
 
-      data_hash( const void* data, const std::size_t size ) noexcept
+      basic_data_hash( const void* data, const std::size_t size ) noexcept
       {
          update( data, size );
       }
 
-      data_hash( data_hash&& ) = delete;
-      data_hash( const data_hash& ) = delete;
+      basic_data_hash( basic_data_hash&& ) = delete;
+      basic_data_hash( const basic_data_hash& ) = delete;
 
-      void operator=( data_hash&& ) = delete;
-      void operator=( const data_hash& ) = delete;
+      void operator=( basic_data_hash&& ) = delete;
+      void operator=( const basic_data_hash& ) = delete;
 
       template< unsigned N >
       void literal( const char( &s )[ N ] )
@@ -50,20 +86,27 @@ namespace filez
 
       [[nodiscard]] std::string result()
       {
-         std::uint8_t tmp[ sha256_hash_size ];
+         std::uint8_t tmp[ hash_traits< H >::size ];
          m_hash.finalise( tmp );
-         return hexdump( tmp, sizeof( tmp ) );
+         return hexdump( hash_traits< H >::tag, tmp, tmp + sizeof( tmp ) );
       }
 
       [[nodiscard]] std::string result( const char c )
       {
-         std::uint8_t tmp[ sha256_hash_size ];
+         std::uint8_t tmp[ hash_traits< H >::size ];
          m_hash.finalise( tmp );
-         return hexdump( c, tmp, sizeof( tmp ) );
+         std::string r = hexdump( c, tmp, sizeof( tmp ) );
+
+         if constexpr( hash_traits< H >::tag != 0 ) {
+            r.insert( r.begin() + 1, hash_traits< H >::tag );
+         }
+         return r;
       }
 
    private:
-      sha256 m_hash;
+      H m_hash;
    };
 
+   using data_hash = basic_data_hash< sha256 >;
+
 }  // namespace filez
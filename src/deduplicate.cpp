@@ -6,6 +6,8 @@
 #include "arguments.hpp"
 #include "deduplicate_args.hpp"
 #include "deduplicate_work.hpp"
+#include "file_filter.hpp"
+#include "hash_args.hpp"
 #include "macros.hpp"
 
 std::vector< std::filesystem::path > paths;
@@ -19,6 +21,10 @@ int main( int argc, char** argv )
    args.add_bool( 'H', fia.H );
    args.add_size( 'c', fia.c );
 
+   filez::global_filter_args().exclude.emplace_back( ".DS_Store" );
+   filez::add_filter_args( args );
+   filez::add_hash_args( args );
+
    if( ( !args.parse_nothrow( argc, argv ) ) || ( paths.size() != 2 ) || ( !fia.valid() ) ) {
       FILEZ_STDERR( "Usage: " << argv[ 0 ] << " [options]... <source_dir> <merged_dir>" );
       FILEZ_STDERR( "  Creates a new directory hierarchy under merged_dir that mirrors source_dir." );
@@ -32,12 +38,17 @@ int main( int argc, char** argv )
       FILEZ_STDERR( "    -c N Copy instead of hard link all files smaller than N bytes, default 0." );
       FILEZ_STDERR( "  Source and merged dir must be on the same filesystem. Merged dir must not exist." );
       FILEZ_STDERR( "  Exactly one of -h and -H must be given." );
+      FILEZ_STDERR( "  Files named .DS_Store are always excluded." );
+      filez::print_filter_args_usage();
+      filez::print_hash_args_usage();
       FILEZ_STDERR( "  The smart hash only hashes two or three small chunks" );
-      FILEZ_STDERR( "    when the file is large and the extension is one for" );
-      FILEZ_STDERR( "    which a partial hash is usually sufficient." );
+      FILEZ_STDERR( "    when the file is large and its format, recognised from the" );
+      FILEZ_STDERR( "    first bytes or the extension, is one for which a partial" );
+      FILEZ_STDERR( "    hash is usually sufficient." );
       FILEZ_STDERR( "  The details are in hash_file.hpp and hash_size.hpp." );
       return 1;
    }
    filez::deduplicate_work( paths.front(), paths.back(), fia ).merge();
+   filez::print_hash_statistics();
    return 0;
 }
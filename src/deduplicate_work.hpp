@@ -12,6 +12,7 @@
 #include "file_info_maps.hpp"
 #include "file_info_sets.hpp"
 #include "filesystem.hpp"
+#include "hash_schedule.hpp"
 #include "macros.hpp"
 #include "utility.hpp"
 
@@ -26,14 +27,15 @@ namespace filez
            m_args( args )
       {
          FILEZ_STDOUT( "Creating directory hierarchy..." );
-         constexpr auto opts = std::filesystem::copy_options::recursive | std::filesystem::copy_options::directories_only | std::filesystem::copy_options::skip_symlinks;
-         std::filesystem::copy( m_src_path, m_new_path, opts );  // TODO: This is slower than expected, optimise?
+         copy_directories( m_src_path, m_new_path );
       }
 
       void merge()
       {
          FILEZ_STDOUT( "Hard linking files..." );
 
+         schedule_bucket_hashing( m_src_files, [ this ]( const auto& fs ){ return ( fs.size() > 1 ) && ( fs.front()->stat().size() > 0 ) && ( fs.front()->stat().size() >= m_args.c ); }, [ this ]( file_info& fi ){ prehash( fi ); } );
+
          for( const auto& kv : m_src_files ) {
             merge( kv.second );
          }
@@ -53,6 +55,16 @@ namespace filez
 
       const deduplicate_args m_args;
 
+      void prehash( file_info& fi ) const
+      {
+         if( m_args.h ) {
+            (void)fi.smart_hash();
+         }
+         else if( m_args.H ) {
+            (void)fi.total_hash();
+         }
+      }
+
       void merge( const std::vector< std::shared_ptr< file_info > >& fs )
       {
          for( const auto& fi : fs ) {
@@ -64,9 +76,6 @@ namespace filez
 
       void merge( const std::vector< std::shared_ptr< file_info > >& fs, file_info& fi )
       {
-         if( fi.path().native().ends_with( ".DS_Store" ) ) {
-            return;
-         }
          const auto to = transfer( fi.path(), m_src_path, m_new_path );
 
          if( fi.stat().size() == 0 ) {
@@ -0,0 +1,114 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+#if defined( __linux__ )
+#include <sys/sysmacros.h>
+#endif
+
+#include "file_info.hpp"
+#include "hash_args.hpp"
+
+namespace filez
+{
+   // Only Linux conveniently tells us whether a device is a rotating disk;
+   // everything unknown, including network filesystems, is treated as not.
+
+   [[nodiscard]] inline bool is_rotational( const ::dev_t device )
+   {
+#if defined( __linux__ )
+      const std::string base = "/sys/dev/block/" + std::to_string( major( device ) ) + ':' + std::to_string( minor( device ) );
+
+      for( const char* sub : { "/queue/rotational", "/../queue/rotational" } ) {  // The latter for partitions.
+         std::ifstream stream( base + sub );
+         int rotational = 0;
+
+         if( stream >> rotational ) {
+            return rotational != 0;
+         }
+      }
+#else
+      (void)device;
+#endif
+      return false;
+   }
+
+   [[nodiscard]] inline std::size_t device_depth( const ::dev_t device )
+   {
+      const hash_args& args = global_hash_args();
+      return std::max( std::size_t( 1 ), is_rotational( device ) ? args.hdd_depth : args.ssd_depth );
+   }
+
+   // Calls f( *fi ) for all files using one queue per device, each queue with its
+   // own number of worker threads, such that all devices are kept busy at the same
+   // time. Within each queue the files are started in the order in which they were
+   // given. The first exception thrown by any f is re-thrown after all workers stop.
+
+   template< typename F >
+   void run_device_queues( const std::vector< file_info* >& files, F&& f )
+   {
+      struct queue
+      {
+         std::vector< file_info* > files;
+         std::atomic< std::size_t > next = 0;
+      };
+      std::deque< queue > queues;
+      std::map< ::dev_t, queue* > devices;
+
+      for( file_info* fi : files ) {
+         auto& q = devices[ fi->stat().device() ];
+
+         if( q == nullptr ) {
+            q = &queues.emplace_back();
+         }
+         q->files.emplace_back( fi );
+      }
+      std::mutex mutex;
+      std::exception_ptr error;
+      std::atomic< bool > stop = false;
+      std::vector< std::thread > threads;
+
+      const auto worker = [ & ]( queue& q ) {
+         try {
+            for( std::size_t i = q.next++; ( i < q.files.size() ) && ( !stop ); i = q.next++ ) {
+               f( *q.files[ i ] );
+            }
+         }
+         catch( ... ) {
+            const std::lock_guard lock( mutex );
+            if( !error ) {
+               error = std::current_exception();
+            }
+            stop = true;
+         }
+      };
+      for( const auto& [ device, q ] : devices ) {
+         const std::size_t depth = std::min( q->files.size(), device_depth( device ) );
+
+         for( std::size_t i = 0; i < depth; ++i ) {
+            threads.emplace_back( worker, std::ref( *q ) );
+         }
+      }
+      for( auto& thread : threads ) {
+         thread.join();
+      }
+      if( error ) {
+         std::rethrow_exception( error );
+      }
+   }
+
+}  // namespace filez
@@ -0,0 +1,118 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <dirent.h>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "file_filter.hpp"
+#include "file_info.hpp"
+#include "file_info_vector.hpp"
+#include "file_stat.hpp"
+#include "macros.hpp"
+
+namespace filez
+{
+   struct dir_closer
+   {
+      void operator()( DIR* dir ) const noexcept
+      {
+         (void)::closedir( dir );
+      }
+   };
+
+   // Alternative to the std::filesystem directory iterators for rotating disks. All entries
+   // of a directory are read with readdir(3) first and then stat'ed in the order of their
+   // inode numbers, which on most filesystems follows the layout of the inode tables on disk,
+   // rather than in the readdir() order, which on ext4 and XFS is the order of the name hashes.
+   // The function object is still called as f( path, stat ) in the readdir() order, and the
+   // recursion into sub-directories happens where recursive_directory_iterator would do it,
+   // so that the resulting order of the entries is the same as with the iterators. Entries
+   // excluded by the global filter are neither stat'ed nor, for directories, descended into.
+
+   template< typename F >
+   void for_each_entry_impl( const std::filesystem::path& path, const bool recursive, const file_filter& filter, const ::dev_t device, F&& f )
+   {
+      struct entry
+      {
+         std::filesystem::path path;
+         ::ino_t inode;
+         file_stat stat;
+      };
+      std::vector< entry > entries;
+      {
+         const std::unique_ptr< DIR, dir_closer > dir( ::opendir( path.c_str() ) );
+
+         if( !dir ) {
+            FILEZ_ERRNO( "unable to opendir(3) path " << path );
+         }
+         while( true ) {
+            errno = 0;
+            const ::dirent* de = ::readdir( dir.get() );
+
+            if( de == nullptr ) {
+               if( errno != 0 ) {
+                  FILEZ_ERRNO( "unable to readdir(3) path " << path );
+               }
+               break;
+            }
+            const std::string_view name( de->d_name );
+
+            if( ( name != "." ) && ( name != ".." ) ) {
+               entries.emplace_back( path / name, de->d_ino );
+
+               if( filter.excludes( entries.back().path ) ) {
+                  entries.pop_back();
+               }
+            }
+         }
+      }
+      std::vector< entry* > order;
+
+      for( auto& e : entries ) {
+         order.emplace_back( &e );
+      }
+      std::sort( order.begin(), order.end(), []( const entry* l, const entry* r ){ return l->inode < r->inode; } );
+
+      for( entry* e : order ) {
+         e->stat.update( e->path );
+      }
+      for( const auto& e : entries ) {
+         f( e.path, e.stat );
+
+         if( recursive && e.stat.is_dir() && ( ( !filter.one_file_system() ) || ( e.stat.device() == device ) ) ) {
+            for_each_entry_impl( e.path, recursive, filter, device, f );
+         }
+      }
+   }
+
+   template< typename F >
+   void for_each_entry( const std::filesystem::path& path, const bool recursive, F&& f )
+   {
+      const file_filter& filter = global_file_filter();
+      const auto device = filter.one_file_system() ? file_stat( path, stat_node ).device() : 0;
+      for_each_entry_impl( path, recursive, filter, device, f );
+   }
+
+   [[nodiscard]] inline file_info_vector make_inode_ordered_file_info_vector( const std::filesystem::path& path, const bool recursive )
+   {
+      file_info_vector result;
+      const file_filter& filter = global_file_filter();
+
+      for_each_entry( path, recursive, [ & ]( const std::filesystem::path& p, const file_stat& stat ){
+         if( filter.selects( p, stat ) ) {
+            result.emplace_back( std::make_shared< file_info >( p, stat ) );
+         }
+      } );
+      return result;
+   }
+
+}  // namespace filez
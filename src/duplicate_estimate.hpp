@@ -0,0 +1,204 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "file_filter.hpp"
+#include "file_info.hpp"
+#include "file_info_vector.hpp"
+#include "file_stat.hpp"
+#include "macros.hpp"
+
+namespace filez
+{
+   // Estimates how many bytes duplicates -h or -H would find to be duplicated, i.e. the
+   // sum of ( n - 1 ) * size over all groups of n files with the same size and hash, within
+   // a time budget. The first half of the budget is spent on a walk that always continues
+   // with a random pending directory, so that a partial walk is spread over the whole tree,
+   // while a size index of all files seen is built and a uniform sample of these files is
+   // kept with reservoir sampling. The rest of the budget is spent on the samples: every
+   // sample is hashed along with all files of the same size to find the number n of files
+   // in its group, and contributes size * ( n - 1 ) / n to the mean, which is scaled up to
+   // all files seen; samples with a unique size need no hashing at all.
+
+   class duplicate_estimate
+   {
+   public:
+      duplicate_estimate( const bool total, const std::size_t seconds, const std::size_t samples )
+         : m_total( total ),
+           m_samples( std::max< std::size_t >( samples, 1 ) ),
+           m_start( std::chrono::steady_clock::now() ),
+           m_deadline( m_start + std::chrono::seconds( seconds ) ),
+           m_random( std::random_device()() )
+      {}
+
+      duplicate_estimate( duplicate_estimate&& ) = delete;
+      duplicate_estimate( const duplicate_estimate& ) = delete;
+
+      void operator=( duplicate_estimate&& ) = delete;
+      void operator=( const duplicate_estimate& ) = delete;
+
+      void walk( const std::vector< std::filesystem::path >& paths, const bool recursive )
+      {
+         const auto deadline = m_start + ( m_deadline - m_start ) / 2;
+         const file_filter& filter = global_file_filter();
+
+         for( const auto& path : paths ) {
+            m_pending.emplace_back( path, filter.one_file_system() ? file_stat( path, stat_node ).device() : 0 );
+         }
+         while( ( !m_pending.empty() ) && ( std::chrono::steady_clock::now() < deadline ) ) {
+            std::swap( m_pending[ std::uniform_int_distribution< std::size_t >( 0, m_pending.size() - 1 )( m_random ) ], m_pending.back() );
+            const auto [ dir, device ] = std::move( m_pending.back() );
+            m_pending.pop_back();
+            ++m_directories;
+
+            for( const auto& de : std::filesystem::directory_iterator( dir ) ) {
+               if( filter.excludes( de.path() ) || de.is_symlink() ) {
+                  continue;
+               }
+               if( de.is_directory() ) {
+                  if( recursive && ( ( !filter.one_file_system() ) || ( file_stat( de.path(), stat_node ).device() == device ) ) ) {
+                     m_pending.emplace_back( de.path(), device );
+                  }
+               }
+               else if( de.is_regular_file() ) {
+                  if( const file_stat st( de.path() ); st.is_file() && filter.selects( de.path(), st ) ) {
+                     add( std::make_shared< file_info >( de.path(), st ) );
+                  }
+               }
+            }
+         }
+      }
+
+      void estimate()
+      {
+         std::shuffle( m_reservoir.begin(), m_reservoir.end(), m_random );
+
+         for( const auto& fi : m_reservoir ) {
+            const std::size_t size = fi->stat().size();
+            const file_info_vector& peers = m_sizes.at( size );
+            std::size_t group = 0;
+
+            if( peers.size() > 1 ) {
+               const std::string key = hash( *fi );
+
+               for( const auto& peer : peers ) {
+                  if( std::chrono::steady_clock::now() >= m_deadline ) {
+                     return;  // The partially examined sample is dropped.
+                  }
+                  group += ( hash( *peer ) == key );
+               }
+            }
+            m_values.emplace_back( ( group > 1 ) ? ( double( size ) * double( group - 1 ) / double( group ) ) : 0.0 );
+         }
+      }
+
+      void print() const
+      {
+         const auto ms = std::chrono::duration_cast< std::chrono::milliseconds >( std::chrono::steady_clock::now() - m_start ).count();
+
+         FILEZ_STDOUT( "Walked " << m_files << " files with " << m_bytes << " bytes in " << m_directories << " directories, " << m_pending.size() << " directories not walked" );
+         FILEZ_STDOUT( "Examined " << m_values.size() << " of " << m_reservoir.size() << " sampled files with " << m_hashed << " hashed files in " << ms << " ms" );
+
+         if( m_values.empty() ) {
+            FILEZ_STDOUT( "No estimate, the time budget was too small to examine any sample" );
+            return;
+         }
+         const double n = double( m_values.size() );
+         double mean = 0.0;
+         double variance = 0.0;
+
+         for( const double v : m_values ) {
+            mean += v;
+         }
+         mean /= n;
+
+         for( const double v : m_values ) {
+            variance += ( v - mean ) * ( v - mean );
+         }
+         variance = ( m_values.size() > 1 ) ? ( variance / ( n - 1.0 ) ) : 0.0;
+
+         // The 95% confidence interval of the normal approximation with the finite population correction.
+
+         const double files = double( m_files );
+         const double correction = ( m_files > 1 ) ? std::sqrt( std::max( files - n, 0.0 ) / ( files - 1.0 ) ) : 0.0;
+         const double margin = 1.96 * std::sqrt( variance / n ) * correction * files;
+         const double estimate = mean * files;
+         const double low = std::max( estimate - margin, 0.0 );
+         const double high = std::min( estimate + margin, double( m_bytes ) );
+
+         FILEZ_STDOUT( "Estimated duplicate bytes " << std::size_t( estimate ) << " (" << percent( estimate ) << "%) with 95% confidence interval " << std::size_t( low ) << " to " << std::size_t( high ) << " (" << percent( low ) << "% to " << percent( high ) << "%)" );
+
+         if( m_values.size() < 30 ) {
+            FILEZ_STDOUT( "The confidence interval is not reliable with fewer than 30 examined samples" );
+         }
+         if( !m_pending.empty() ) {
+            FILEZ_STDOUT( "Duplicates of files in directories that were not walked are not included" );
+         }
+      }
+
+   private:
+      const bool m_total;
+      const std::size_t m_samples;
+      const std::chrono::steady_clock::time_point m_start;
+      const std::chrono::steady_clock::time_point m_deadline;
+
+      std::mt19937_64 m_random;
+      std::vector< std::pair< std::filesystem::path, ::dev_t > > m_pending;
+
+      std::size_t m_files = 0;
+      std::size_t m_bytes = 0;
+      std::size_t m_hashed = 0;
+      std::size_t m_directories = 0;
+
+      std::unordered_map< std::size_t, file_info_vector > m_sizes;
+      file_info_vector m_reservoir;
+      std::vector< double > m_values;
+
+      void add( std::shared_ptr< file_info >&& fi )
+      {
+         const std::size_t size = fi->stat().size();
+         ++m_files;
+         m_bytes += size;
+
+         if( m_reservoir.size() < m_samples ) {
+            m_reservoir.emplace_back( fi );
+         }
+         else if( const std::size_t i = std::uniform_int_distribution< std::size_t >( 0, m_files - 1 )( m_random ); i < m_samples ) {
+            m_reservoir[ i ] = fi;
+         }
+         m_sizes[ size ].emplace_back( std::move( fi ) );
+      }
+
+      [[nodiscard]] std::string hash( file_info& fi )
+      {
+         m_hashed += ( m_total ? fi.known_total_hash() : fi.known_smart_hash() ).empty();
+         return m_total ? fi.total_hash() : fi.smart_hash();
+      }
+
+      [[nodiscard]] double percent( const double bytes ) const noexcept
+      {
+         return m_bytes ? ( 100.0 * bytes / double( m_bytes ) ) : 0.0;
+      }
+   };
+
+   inline void estimate_duplicates( const std::vector< std::filesystem::path >& paths, const bool recursive, const bool total, const std::size_t seconds, const std::size_t samples )
+   {
+      duplicate_estimate estimate( total, seconds, samples );
+      estimate.walk( paths, recursive );
+      estimate.estimate();
+      estimate.print();
+   }
+
+}  // namespace filez
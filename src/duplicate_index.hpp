@@ -0,0 +1,258 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "file_info.hpp"
+#include "file_info_vector.hpp"
+#include "file_stat.hpp"
+#include "group_pipeline.hpp"
+#include "hash_cache.hpp"
+#include "macros.hpp"
+
+namespace filez
+{
+   // Incrementally maintained version of the size and smart hash, or size and total hash,
+   // grouping of duplicates -h and -H for long-running processes. The files are kept in
+   // buckets by size in the order in which they were added, and the set of sizes shared by
+   // more than one file is maintained along with the buckets, so that a report only looks
+   // at the candidate groups. The hashes are cached in the file_info objects, which are only
+   // replaced when the stat of a file changes, so that a report only hashes new and changed
+   // files; small groups are therefore also hashed instead of compared byte by byte, which
+   // would re-read all of their files for every report. The paths of files with multiple
+   // hard links are also indexed by node because a change via one path is a change of all
+   // other paths to the same node.
+
+   class duplicate_index
+   {
+   public:
+      explicit duplicate_index( const bool total ) noexcept
+         : m_total( total )
+      {}
+
+      duplicate_index( duplicate_index&& ) = delete;
+      duplicate_index( const duplicate_index& ) = delete;
+
+      void operator=( duplicate_index&& ) = delete;
+      void operator=( const duplicate_index& ) = delete;
+
+      [[nodiscard]] std::size_t size() const noexcept
+      {
+         return m_paths.size();
+      }
+
+      void add( const file_info_vector& list )
+      {
+         for( const auto& fi : list ) {
+            if( fi->is_file() ) {
+               insert( fi );
+            }
+         }
+      }
+
+      // Adds, replaces or removes the path depending on whether and how it changed; throws
+      // when the path can not be stat'ed, e.g. because it was removed in the meantime, while
+      // other links to the same node that can't be stat'ed anymore are removed.
+
+      void update( const std::filesystem::path& path )
+      {
+         const file_stat stat( path );
+
+         if( !stat.is_file() ) {
+            remove( path );
+            return;
+         }
+         if( const auto iter = m_paths.find( path.native() ); iter != m_paths.end() ) {
+            const file_stat& old = iter->second.info->stat();
+
+            if( ( old.node() == stat.node() ) && ( old.size() == stat.size() ) && ( old.mtime() == stat.mtime() ) && ( old.links() == stat.links() ) ) {
+               return;  // E.g. after a chmod(1) or a close() without writing.
+            }
+         }
+         invalidate( stat );
+         insert( std::make_shared< file_info >( path, stat ) );
+
+         if( stat.links() > 1 ) {
+            for( const auto& other : linked_paths( stat.node(), path.native() ) ) {
+               try {
+                  insert( std::make_shared< file_info >( other, file_stat( other ) ) );
+               }
+               catch( const std::exception& e ) {
+                  remove( other );  // The other link vanished, the updated path is fine.
+                  FILEZ_STDERR( "ignoring " << std::filesystem::path( other ) << " -- " << e.what() );
+               }
+            }
+         }
+      }
+
+      void remove( const std::filesystem::path& path )
+      {
+         if( const auto iter = m_paths.find( path.native() ); iter != m_paths.end() ) {
+            invalidate( iter->second.info->stat() );
+            erase( iter );
+         }
+      }
+
+      // Removes the path and all paths below it.
+
+      void remove_tree( const std::filesystem::path& path )
+      {
+         remove( path );
+         const std::string prefix = path.native() + '/';
+
+         for( auto iter = m_paths.lower_bound( prefix ); ( iter != m_paths.end() ) && iter->first.starts_with( prefix ); ) {
+            invalidate( iter->second.info->stat() );
+            iter = erase( iter );
+         }
+      }
+
+      void clear()
+      {
+         m_paths.clear();
+         m_sizes.clear();
+         m_shared.clear();
+         m_links.clear();
+      }
+
+      // Prints the same report as duplicates -h or -H would for the current files.
+
+      void report() const
+      {
+         std::vector< file_info_group > groups;
+
+         for( const std::size_t size : m_shared ) {
+            file_info_group& group = groups.emplace_back();
+
+            for( const auto& [ seq, fi ] : m_sizes.at( size ) ) {
+               group.emplace_back( fi );
+            }
+         }
+         if( m_total ) {
+            report_impl< total_hash_key >( groups, "total" );
+         }
+         else {
+            report_impl< smart_hash_key >( groups, "smart" );
+         }
+      }
+
+   private:
+      struct entry
+      {
+         std::size_t seq = 0;  // Position in the size bucket, retained when a file is replaced.
+         std::shared_ptr< file_info > info;
+      };
+
+      const bool m_total;
+      std::size_t m_seq = 0;
+
+      std::map< std::string, entry > m_paths;  // Ordered for remove_tree().
+      std::map< std::size_t, std::map< std::size_t, std::shared_ptr< file_info > > > m_sizes;
+      std::set< std::size_t > m_shared;  // The sizes with more than one file.
+      std::map< file_node, std::set< std::string > > m_links;  // Only for files with multiple links.
+
+      void insert( const std::shared_ptr< file_info >& fi )
+      {
+         const auto [ iter, inserted ] = m_paths.try_emplace( fi->path().native() );
+
+         if( inserted ) {
+            iter->second.seq = m_seq++;
+         }
+         else {
+            unlink( iter->second );
+         }
+         iter->second.info = fi;
+
+         const file_stat& stat = fi->stat();
+         auto& bucket = m_sizes[ stat.size() ];
+         bucket.insert_or_assign( iter->second.seq, fi );
+
+         if( bucket.size() == 2 ) {
+            m_shared.insert( stat.size() );
+         }
+         if( stat.links() > 1 ) {
+            m_links[ stat.node() ].insert( iter->first );
+         }
+      }
+
+      // Removes the entry from the size bucket and the node index, but not from m_paths.
+
+      void unlink( const entry& e )
+      {
+         const file_stat& stat = e.info->stat();
+         const auto iter = m_sizes.find( stat.size() );
+         iter->second.erase( e.seq );
+
+         if( iter->second.size() < 2 ) {
+            m_shared.erase( stat.size() );
+         }
+         if( iter->second.empty() ) {
+            m_sizes.erase( iter );
+         }
+         if( stat.links() > 1 ) {
+            if( const auto jter = m_links.find( stat.node() ); jter != m_links.end() ) {
+               jter->second.erase( e.info->path().native() );
+
+               if( jter->second.empty() ) {
+                  m_links.erase( jter );
+               }
+            }
+         }
+      }
+
+      std::map< std::string, entry >::iterator erase( const std::map< std::string, entry >::iterator iter )
+      {
+         unlink( iter->second );
+         return m_paths.erase( iter );
+      }
+
+      [[nodiscard]] std::vector< std::string > linked_paths( const file_node node, const std::string& except ) const
+      {
+         std::vector< std::string > result;
+
+         if( const auto iter = m_links.find( node ); iter != m_links.end() ) {
+            for( const auto& path : iter->second ) {
+               if( path != except ) {
+                  result.emplace_back( path );
+               }
+            }
+         }
+         return result;
+      }
+
+      static void invalidate( const file_stat& stat )
+      {
+         if( stat.links() > 1 ) {
+            global_smart_hash_cache().invalidate( stat.node() );
+            global_total_hash_cache().invalidate( stat.node() );
+         }
+      }
+
+      template< typename K >
+      static void report_impl( const std::vector< file_info_group >& groups, const char* hash )
+      {
+         K::schedule( groups );
+
+         for( const auto& group : groups ) {
+            partition_group< K >( group, [ & ]( const file_info_group& g ){
+               if( g.size() > 1 ) {
+                  FILEZ_STDOUT( g.size() << " duplicates with same size " << g.front()->stat().size() << " and same " << hash << " hash" );
+
+                  for( const auto& fi : g ) {
+                     FILEZ_STDOUT( "   " << fi->path() );
+                  }
+               }
+            } );
+         }
+      }
+   };
+
+}  // namespace filez
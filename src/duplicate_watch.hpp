@@ -0,0 +1,296 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <set>
+#include <signal.h>
+#include <string>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#if defined( __linux__ )
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#endif
+
+#include "duplicate_index.hpp"
+#include "file_filter.hpp"
+#include "file_info_vector.hpp"
+#include "macros.hpp"
+
+namespace filez
+{
+#if defined( __linux__ )
+
+   // Watches directories with inotify(7), which, unlike fanotify(7), neither needs root
+   // nor a filesystem mark, but needs one watch per directory; with many directories
+   // the limit in /proc/sys/fs/inotify/max_user_watches might need to be raised.
+
+   class directory_watch
+   {
+   public:
+      directory_watch()
+         : m_fd( ::inotify_init1( IN_CLOEXEC ) )
+      {
+         if( m_fd < 0 ) {
+            FILEZ_ERRNO( "unable to initialise inotify" );
+         }
+      }
+
+      ~directory_watch()
+      {
+         ::close( m_fd );
+      }
+
+      directory_watch( directory_watch&& ) = delete;
+      directory_watch( const directory_watch& ) = delete;
+
+      void operator=( directory_watch&& ) = delete;
+      void operator=( const directory_watch& ) = delete;
+
+      [[nodiscard]] int fd() const noexcept
+      {
+         return m_fd;
+      }
+
+      [[nodiscard]] std::size_t size() const noexcept
+      {
+         return m_paths.size();
+      }
+
+      void add( const std::filesystem::path& path )
+      {
+         const int wd = ::inotify_add_watch( m_fd, path.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR | IN_DONT_FOLLOW );
+
+         if( wd < 0 ) {
+            FILEZ_ERRNO( "unable to watch directory " << path );
+         }
+         m_paths.insert_or_assign( wd, path );
+      }
+
+      // Adds watches for the directory and, when recursive, for all directories below it that are not excluded by the filter.
+
+      void add_tree( const std::filesystem::path& path, const bool recursive )
+      {
+         add( path );
+
+         if( recursive ) {
+            filtered_walk< std::filesystem::recursive_directory_iterator >( path, [ & ]( const std::filesystem::directory_entry& de ){
+               if( ( !de.is_symlink() ) && de.is_directory() ) {
+                  add( de.path() );
+               }
+            } );
+         }
+      }
+
+      // Removes the watches of the directory and of all directories below it, e.g. when it was moved away.
+
+      void remove_tree( const std::filesystem::path& path )
+      {
+         const std::string prefix = path.native() + '/';
+
+         std::erase_if( m_paths, [ & ]( const auto& wp ){
+            if( ( wp.second == path ) || wp.second.native().starts_with( prefix ) ) {
+               (void)::inotify_rm_watch( m_fd, wp.first );
+               return true;
+            }
+            return false;
+         } );
+      }
+
+      // Reads the pending events and calls f( mask, path ) for each one; the mask IN_Q_OVERFLOW
+      // with an empty path means that events were lost.
+
+      template< typename F >
+      void read( F&& f )
+      {
+         alignas( ::inotify_event ) char buffer[ 64 * 1024 ];
+         const ::ssize_t got = ::read( m_fd, buffer, sizeof( buffer ) );
+
+         if( got < 0 ) {
+            if( ( errno == EINTR ) || ( errno == EAGAIN ) ) {
+               return;
+            }
+            FILEZ_ERRNO( "unable to read inotify events" );
+         }
+         for( ::ssize_t i = 0; i < got; ) {
+            const auto* event = reinterpret_cast< const ::inotify_event* >( buffer + i );
+            i += sizeof( ::inotify_event ) + event->len;
+
+            if( event->mask & IN_Q_OVERFLOW ) {
+               f( event->mask, std::filesystem::path() );
+               continue;
+            }
+            const auto iter = m_paths.find( event->wd );
+
+            if( iter == m_paths.end() ) {
+               continue;  // Events that were queued before the watch was removed.
+            }
+            if( event->mask & IN_IGNORED ) {
+               m_paths.erase( iter );
+               continue;
+            }
+            if( event->len > 0 ) {
+               f( event->mask, iter->second / event->name );
+            }
+         }
+      }
+
+   private:
+      const int m_fd;
+      std::unordered_map< int, std::filesystem::path > m_paths;
+   };
+
+   inline void watch_duplicates_scan( duplicate_index& index, const std::filesystem::path& path, const bool recursive )
+   {
+      index.add( recursive ? make_full_file_info_vector( path ) : make_file_info_vector( path ) );
+   }
+
+   // Applies a single event to the index; the paths can vanish at any time, which is not an error here.
+
+   inline void watch_duplicates_event( duplicate_index& index, directory_watch& watch, const std::uint32_t mask, const std::filesystem::path& path, const bool recursive )
+   {
+      if( global_file_filter().excludes( path ) ) {
+         return;
+      }
+      try {
+         if( mask & IN_ISDIR ) {
+            if( mask & ( IN_DELETE | IN_MOVED_FROM ) ) {
+               watch.remove_tree( path );
+               index.remove_tree( path );
+            }
+            else if( recursive && ( mask & ( IN_CREATE | IN_MOVED_TO ) ) ) {
+               // Watch first, then scan, so that nothing created in between is missed.
+               watch.add_tree( path, recursive );
+               index.remove_tree( path );
+               watch_duplicates_scan( index, path, recursive );
+            }
+            return;
+         }
+         if( mask & ( IN_DELETE | IN_MOVED_FROM ) ) {
+            index.remove( path );
+         }
+         else {
+            index.update( path );
+         }
+      }
+      catch( const std::exception& e ) {
+         index.remove( path );
+         FILEZ_STDERR( "ignoring " << path << " -- " << e.what() );
+      }
+   }
+
+   // Long-running alternative to a one-off duplicates -h or -H: scans the directories once,
+   // prints the duplicates, and then keeps the grouping up-to-date with the changes reported
+   // by inotify. SIGUSR1 prints the current duplicates, which only needs to hash the files
+   // that were changed since the last report, SIGINT or SIGTERM end the process. Files are
+   // usually updated when they are closed after writing; files that were modified but not
+   // closed, e.g. by a writer that keeps them open, are only collected and updated once
+   // before the next report, rather than for every single write.
+
+   inline void watch_duplicates( const std::vector< std::filesystem::path >& paths, const bool recursive, const bool total )
+   {
+      ::sigset_t signals;
+      ::sigemptyset( &signals );
+      ::sigaddset( &signals, SIGUSR1 );
+      ::sigaddset( &signals, SIGINT );
+      ::sigaddset( &signals, SIGTERM );
+
+      // Blocked before any threads are started so that they all inherit the mask.
+
+      if( ::pthread_sigmask( SIG_BLOCK, &signals, nullptr ) != 0 ) {
+         FILEZ_ERROR( "unable to block signals" );
+      }
+      const int sfd = ::signalfd( -1, &signals, SFD_CLOEXEC );
+
+      if( sfd < 0 ) {
+         FILEZ_ERRNO( "unable to create signalfd" );
+      }
+      duplicate_index index( total );
+      directory_watch watch;
+      std::set< std::filesystem::path > modified;
+
+      const auto rescan = [ & ](){
+         index.clear();
+         modified.clear();
+
+         for( const auto& path : paths ) {
+            watch.add_tree( path, recursive );
+            watch_duplicates_scan( index, path, recursive );
+         }
+      };
+      const auto report = [ & ](){
+         for( const auto& path : modified ) {
+            watch_duplicates_event( index, watch, IN_MODIFY, path, recursive );
+         }
+         modified.clear();
+         const auto start = std::chrono::steady_clock::now();
+         index.report();
+         const auto ms = std::chrono::duration_cast< std::chrono::milliseconds >( std::chrono::steady_clock::now() - start ).count();
+         FILEZ_STDERR( "Reported on " << index.size() << " files in " << watch.size() << " directories in " << ms << " ms" );
+      };
+      rescan();
+      report();
+
+      while( true ) {
+         ::pollfd fds[ 2 ] = { { watch.fd(), POLLIN, 0 }, { sfd, POLLIN, 0 } };
+
+         if( ::poll( fds, 2, -1 ) < 0 ) {
+            if( errno == EINTR ) {
+               continue;
+            }
+            FILEZ_ERRNO( "unable to poll() inotify and signals" );
+         }
+         if( fds[ 1 ].revents & POLLIN ) {
+            ::signalfd_siginfo info;
+
+            if( ::read( sfd, &info, sizeof( info ) ) != sizeof( info ) ) {
+               FILEZ_ERRNO( "unable to read signalfd" );
+            }
+            if( info.ssi_signo != SIGUSR1 ) {
+               break;
+            }
+            report();
+         }
+         if( fds[ 0 ].revents & POLLIN ) {
+            bool overflow = false;
+
+            watch.read( [ & ]( const std::uint32_t mask, const std::filesystem::path& path ){
+               if( mask & IN_Q_OVERFLOW ) {
+                  overflow = true;
+               }
+               else if( ( mask & IN_MODIFY ) && !( mask & IN_ISDIR ) ) {
+                  modified.insert( path );
+               }
+               else if( !overflow ) {
+                  modified.erase( path );
+                  watch_duplicates_event( index, watch, mask, path, recursive );
+               }
+            } );
+            if( overflow ) {
+               FILEZ_STDERR( "Events were lost, rescanning" );
+               rescan();
+            }
+         }
+      }
+      ::close( sfd );
+   }
+
+#else
+
+   inline void watch_duplicates( const std::vector< std::filesystem::path >&, const bool, const bool )
+   {
+      FILEZ_ERROR( "watching directories requires inotify and is only supported on Linux" );
+   }
+
+#endif
+
+}  // namespace filez
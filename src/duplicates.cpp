@@ -1,11 +1,21 @@
 // Copyright (c) 2022-2025 Dr. Colin Hirsch - All Rights Reserved
 
 #include <filesystem>
+#include <string>
 #include <vector>
 
 #include "arguments.hpp"
+#include "directory_scan.hpp"
+#include "duplicate_estimate.hpp"
+#include "duplicate_watch.hpp"
+#include "file_compare.hpp"
+#include "file_filter.hpp"
 #include "file_info_vector.hpp"
+#include "hash_args.hpp"
 #include "macros.hpp"
+#include "root_scan.hpp"
+#include "scan_snapshot.hpp"
+#include "size_spill.hpp"
 
 #include "find_duplicates.hpp"
 #include "found_node_duplicates.hpp"
@@ -19,6 +29,16 @@
 
 bool canonical = true;
 bool recursive = true;
+bool inode_order = false;
+bool two_pass = false;
+std::size_t memory_limit = 0;
+bool size_mode = true;  // Whether the mode only finds files with the same size.
+char mode = 'h';
+bool watch = false;
+std::size_t estimate = 0;
+std::size_t estimate_samples = 1000;
+std::string save_scan;
+std::string load_scan;
 
 std::vector< std::filesystem::path > paths;
 
@@ -31,20 +51,36 @@ int main( int argc, char** argv )
    args.add_bool( 'C', canonical );
    args.add_bool( 'R', recursive );
 
-   args.add_bool( 'n', []( const std::string_view ){ finder = std::make_shared< filez::find_duplicates< filez::name_duplicates > >(); } );
-   args.add_bool( 'N', []( const std::string_view ){ finder = std::make_shared< filez::find_duplicates< filez::name_size_duplicates > >(); } );
+   args.add_bool( 'n', []( const std::string_view ){ mode = 'n'; size_mode = false; finder = std::make_shared< filez::find_duplicates< filez::name_duplicates > >(); } );
+   args.add_bool( 'N', []( const std::string_view ){ mode = 'N'; size_mode = true; finder = std::make_shared< filez::find_duplicates< filez::name_size_duplicates > >(); } );
 
-   args.add_bool( 'i', []( const std::string_view ){ finder = std::make_shared< filez::find_duplicates< filez::found_node_duplicates > >(); } );
-   args.add_bool( 'I', []( const std::string_view ){ finder = std::make_shared< filez::find_duplicates< filez::total_node_duplicates > >(); } );
+   args.add_bool( 'i', []( const std::string_view ){ mode = 'i'; size_mode = false; finder = std::make_shared< filez::find_duplicates< filez::found_node_duplicates > >(); } );
+   args.add_bool( 'I', []( const std::string_view ){ mode = 'I'; size_mode = false; finder = std::make_shared< filez::find_duplicates< filez::total_node_duplicates > >(); } );
 
-   args.add_bool( 'h', []( const std::string_view ){ /* finder = std::make_shared< filez::find_duplicates< filez::smart_hash_size_duplicates > >(); */ } );
-   args.add_bool( 'H', []( const std::string_view ){ finder = std::make_shared< filez::find_duplicates< filez::total_hash_size_duplicates > >(); } );
+   args.add_bool( 'h', []( const std::string_view ){ mode = 'h'; size_mode = true; /* finder = std::make_shared< filez::find_duplicates< filez::smart_hash_size_duplicates > >(); */ } );
+   args.add_bool( 'H', []( const std::string_view ){ mode = 'H'; size_mode = true; finder = std::make_shared< filez::find_duplicates< filez::total_hash_size_duplicates > >(); } );
 
-   args.add_bool( 'x', []( const std::string_view ){ finder = std::make_shared< filez::find_duplicates< filez::name_smart_hash_size_duplicates > >(); } );
-   args.add_bool( 'X', []( const std::string_view ){ finder = std::make_shared< filez::find_duplicates< filez::name_total_hash_size_duplicates > >(); } );
+   args.add_bool( 'x', []( const std::string_view ){ mode = 'x'; size_mode = true; finder = std::make_shared< filez::find_duplicates< filez::name_smart_hash_size_duplicates > >(); } );
+   args.add_bool( 'X', []( const std::string_view ){ mode = 'X'; size_mode = true; finder = std::make_shared< filez::find_duplicates< filez::name_total_hash_size_duplicates > >(); } );
 
-   if( ( !args.parse_nothrow( argc, argv ) ) || paths.empty() ) {
+   args.add_size( "compare-max", filez::global_compare_args().compare_max );
+   args.add_bool( "paranoid", filez::global_compare_args().paranoid );
+   args.add_bool( "two-pass", two_pass );
+   args.add_size( "memory-limit", memory_limit );
+   args.add_bool( "dont-sync", filez::global_stat_args().dont_sync );
+   args.add_bool( "inode-order", inode_order );
+   args.add_bool( "watch", watch );
+   args.add_size( "estimate", estimate );
+   args.add_size( "estimate-samples", estimate_samples );
+   args.add_string( "save-scan", save_scan );
+   args.add_string( "load-scan", load_scan );
+
+   filez::add_filter_args( args );
+   filez::add_hash_args( args );
+
+   if( ( !args.parse_nothrow( argc, argv ) ) || ( paths.empty() == load_scan.empty() ) ) {
       FILEZ_STDERR( "Usage: " << argv[ 0 ] << " [OPTION]... DIRECTORY [DIRECTORY]..." );
+      FILEZ_STDERR( "   or: " << argv[ 0 ] << " [OPTION]... --load-scan FILE" );
       FILEZ_STDERR( "  Finds duplicate files in one or more directories." );
       FILEZ_STDERR( "  Files are duplicates when they have the same..." );
       FILEZ_STDERR( "    -n   file name." );
@@ -58,10 +94,35 @@ int main( int argc, char** argv )
       FILEZ_STDERR( "  Additional options are..." );
       FILEZ_STDERR( "    -R   to change to non-recursive scanning." );
       FILEZ_STDERR( "    -C   to disable normalising the given paths." );
+      FILEZ_STDERR( "    --compare-max N  to compare files instead of hashing for -H and -X when" );
+      FILEZ_STDERR( "                     at most N files have the same size, default 3," );
+      FILEZ_STDERR( "                     except with --watch which always hashes for -H." );
+      FILEZ_STDERR( "                     Such small groups are reported as having the same" );
+      FILEZ_STDERR( "                     total hash but were compared byte by byte instead." );
+      FILEZ_STDERR( "    --paranoid       to confirm same total hashes by comparing the files." );
+      FILEZ_STDERR( "    --two-pass       to scan twice to only keep files whose size is not unique" );
+      FILEZ_STDERR( "                     in memory, for all modes except -n, -i and -I." );
+      FILEZ_STDERR( "    --memory-limit N to keep at most about N MiB of file records in memory" );
+      FILEZ_STDERR( "                     and use temporary files for the rest, same modes." );
+      FILEZ_STDERR( "    --dont-sync      to accept cached file attributes on network filesystems." );
+      FILEZ_STDERR( "    --inode-order    to stat the entries of every directory in inode order." );
+      FILEZ_STDERR( "    --watch          to keep running and watching the directories for changes" );
+      FILEZ_STDERR( "                     after the first report, for -h and -H, Linux only;" );
+      FILEZ_STDERR( "                     SIGUSR1 prints the current duplicates, SIGINT ends." );
+      FILEZ_STDERR( "    --estimate N     to only estimate the number of duplicated bytes within" );
+      FILEZ_STDERR( "                     about N seconds by hashing a random sample of files" );
+      FILEZ_STDERR( "                     and the files of the same size, for -h and -H." );
+      FILEZ_STDERR( "    --estimate-samples K  to set the sample size for --estimate, default 1000." );
+      FILEZ_STDERR( "    --save-scan FILE to save the scanned entries and the calculated hashes." );
+      FILEZ_STDERR( "    --load-scan FILE to use the saved entries and hashes instead of scanning" );
+      FILEZ_STDERR( "                     the directories again, e.g. to try another mode." );
       FILEZ_STDERR( "  Special files like devices and pipes are ignored." );
+      filez::print_filter_args_usage();
+      filez::print_hash_args_usage();
       FILEZ_STDERR( "  The smart hash only hashes two or three small chunks" );
-      FILEZ_STDERR( "    when the file is large and the extension is one for" );
-      FILEZ_STDERR( "    which a partial hash is usually sufficient." );
+      FILEZ_STDERR( "    when the file is large and its format, recognised from the" );
+      FILEZ_STDERR( "    first bytes or the extension, is one for which a partial" );
+      FILEZ_STDERR( "    hash is usually sufficient." );
       FILEZ_STDERR( "  The details are in hash_file.hpp and hash_size.hpp." );
       return 1;
    }
@@ -69,8 +130,92 @@ int main( int argc, char** argv )
       if( canonical ) {
          path = std::filesystem::canonical( path );
       }
-      finder->add( recursive ? filez::make_full_file_info_vector( path ) : filez::make_file_info_vector( path ) );
    }
-   finder->work();
+   if( inode_order && ( two_pass || ( memory_limit > 0 ) ) && size_mode ) {
+      FILEZ_STDERR( "Option --inode-order can not be combined with --two-pass or --memory-limit." );
+      return 1;
+   }
+   if( ( !save_scan.empty() || !load_scan.empty() ) && ( two_pass || ( memory_limit > 0 ) || watch ) ) {
+      FILEZ_STDERR( "Options --save-scan and --load-scan can not be combined with --two-pass, --memory-limit or --watch." );
+      return 1;
+   }
+   if( watch && ( two_pass || ( memory_limit > 0 ) || inode_order ) ) {
+      FILEZ_STDERR( "Option --watch can not be combined with --two-pass, --memory-limit or --inode-order." );
+      return 1;
+   }
+   if( estimate > 0 ) {
+      if( watch || ( !save_scan.empty() ) || ( !load_scan.empty() ) || two_pass || ( memory_limit > 0 ) || inode_order ) {
+         FILEZ_STDERR( "Option --estimate can not be combined with --watch, --save-scan, --load-scan, --two-pass, --memory-limit or --inode-order." );
+         return 1;
+      }
+      if( ( mode != 'h' ) && ( mode != 'H' ) ) {
+         FILEZ_STDERR( "Option --estimate only supports the modes -h and -H." );
+         return 1;
+      }
+      filez::estimate_duplicates( paths, recursive, mode == 'H', estimate, estimate_samples );
+      filez::print_hash_statistics();
+      return 0;
+   }
+   if( watch ) {
+      if( ( mode != 'h' ) && ( mode != 'H' ) ) {
+         FILEZ_STDERR( "Option --watch only supports the modes -h and -H." );
+         return 1;
+      }
+      filez::watch_duplicates( paths, recursive, mode == 'H' );
+      filez::print_hash_statistics();
+      return 0;
+   }
+   filez::size_scan_stats stats;
+
+   if( ( memory_limit > 0 ) && size_mode ) {
+      // The output is ordered by size first, so the size groups can be processed one batch at a time.
+      filez::size_spill spill( memory_limit * 1024 * 1024, stats );
+      filez::spill_file_sizes( paths, recursive, spill );
+      spill.merge( []( filez::file_info_vector&& batch ){
+         finder->add( batch );
+         finder->work();
+      } );
+   }
+   else {
+      filez::scan_snapshot snapshot;
+
+      if( two_pass && size_mode ) {
+         finder->add( filez::make_size_pruned_file_info_vector( paths, recursive, stats ) );
+      }
+      else {
+         if( !load_scan.empty() ) {
+            snapshot = filez::load_scan_snapshot( load_scan );
+         }
+         else {
+            snapshot.roots = paths;
+            snapshot.lists.resize( paths.size() );
+
+            filez::for_each_root_concurrently( paths, [ & ]( const std::size_t i ){
+               if( inode_order ) {
+                  snapshot.lists[ i ] = filez::make_inode_ordered_file_info_vector( paths[ i ], recursive );
+               }
+               else {
+                  snapshot.lists[ i ] = recursive ? filez::make_full_file_info_vector( paths[ i ] ) : filez::make_file_info_vector( paths[ i ] );
+               }
+            } );
+         }
+         for( const auto& list : snapshot.lists ) {
+            finder->add( list );
+         }
+         if( save_scan.empty() ) {
+            snapshot.lists.clear();  // The finder holds its own references to the files.
+         }
+      }
+      finder->work();
+
+      if( !save_scan.empty() ) {
+         // Saved after the work to include the hashes that it calculated.
+         filez::save_scan_snapshot( save_scan, snapshot );
+      }
+   }
+   if( ( two_pass || ( memory_limit > 0 ) ) && size_mode ) {
+      filez::print_size_scan_stats( stats );
+   }
+   filez::print_hash_statistics();
    return 0;
 }
@@ -0,0 +1,203 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "file_info.hpp"
+#include "file_open.hpp"
+#include "macros.hpp"
+
+namespace filez
+{
+   struct compare_args
+   {
+      std::size_t compare_max = 3;  // Groups up to this size are compared instead of hashed.
+      bool paranoid = false;  // Hash matches are confirmed with a byte comparison.
+   };
+
+   [[nodiscard]] inline compare_args& global_compare_args() noexcept
+   {
+      static compare_args args;
+      return args;
+   }
+
+   using file_info_group = std::vector< std::shared_ptr< file_info > >;
+
+   // Partitions a group of files of the same size into groups with identical contents by
+   // reading all files in lockstep and splitting a group as soon as its members diverge;
+   // reading stops for files that are known to be unique. Multiple hard links to the
+   // same inode are read only once. The order of the files in the groups is retained.
+   // Only one buffer per distinct chunk content is kept in memory, and every file is
+   // only opened while reading a chunk, to not run out of memory or file descriptors
+   // when --paranoid is used on a large group.
+
+   class file_compare
+   {
+   public:
+      static constexpr std::size_t chunk_size = 1024 * 1024;
+
+      explicit file_compare( const file_info_group& group )
+      {
+         std::map< file_node, std::size_t > nodes;
+
+         for( const auto& fi : group ) {
+            const auto [ iter, inserted ] = nodes.try_emplace( fi->stat().node(), m_nodes.size() );
+
+            if( inserted ) {
+               m_nodes.emplace_back();
+            }
+            m_nodes[ iter->second ].emplace_back( fi );
+         }
+      }
+
+      file_compare( file_compare&& ) = delete;
+      file_compare( const file_compare& ) = delete;
+
+      void operator=( file_compare&& ) = delete;
+      void operator=( const file_compare& ) = delete;
+
+      [[nodiscard]] std::vector< file_info_group > work()
+      {
+         std::vector< std::vector< std::size_t > > classes( 1 );
+
+         for( std::size_t i = 0; i < m_nodes.size(); ++i ) {
+            classes.front().emplace_back( i );
+         }
+         for( std::size_t offset = 0; m_more; offset += chunk_size ) {
+            m_more = false;
+            std::vector< std::vector< std::size_t > > next;
+
+            for( const auto& c : classes ) {
+               if( c.size() > 1 ) {
+                  split( c, offset, next );
+               }
+               else {
+                  next.emplace_back( c );
+               }
+            }
+            classes.swap( next );
+         }
+         std::vector< file_info_group > result;
+
+         for( const auto& c : classes ) {
+            result.emplace_back();
+
+            for( const std::size_t i : c ) {
+               result.back().insert( result.back().end(), m_nodes[ i ].begin(), m_nodes[ i ].end() );
+            }
+         }
+         return result;
+      }
+
+   private:
+      struct chunk
+      {
+         std::unique_ptr< char[] > buffer = std::make_unique< char[] >( chunk_size );
+         std::size_t length = 0;
+      };
+
+      bool m_more = true;
+      std::vector< file_info_group > m_nodes;
+
+      void read( const std::size_t i, const std::size_t offset, chunk& c )
+      {
+         const std::filesystem::path& path = m_nodes[ i ].front()->path();
+         const file_open open( path );
+
+         c.length = 0;
+
+         while( c.length < chunk_size ) {
+            const ::ssize_t r = ::pread( open.get(), c.buffer.get() + c.length, chunk_size - c.length, ::off_t( offset + c.length ) );
+
+            if( r < 0 ) {
+               FILEZ_ERRNO( "unable to pread() file " << path );
+            }
+            if( r == 0 ) {
+               return;
+            }
+            c.length += std::size_t( r );
+         }
+         m_more = true;
+      }
+
+      [[nodiscard]] static bool equal( const chunk& l, const chunk& r ) noexcept
+      {
+         return ( l.length == r.length ) && ( std::memcmp( l.buffer.get(), r.buffer.get(), l.length ) == 0 );
+      }
+
+      void split( const std::vector< std::size_t >& c, const std::size_t offset, std::vector< std::vector< std::size_t > >& next )
+      {
+         const std::size_t first = next.size();
+
+         std::vector< chunk > chunks;
+         chunk scratch;
+
+         for( const std::size_t i : c ) {
+            read( i, offset, scratch );
+            std::size_t j = 0;
+
+            while( ( j < chunks.size() ) && ( !equal( chunks[ j ], scratch ) ) ) {
+               ++j;
+            }
+            if( j == chunks.size() ) {
+               chunks.emplace_back( std::move( scratch ) );
+               scratch = chunk();
+               next.emplace_back();
+            }
+            next[ first + j ].emplace_back( i );
+         }
+      }
+   };
+
+   // Finds the groups of files with identical contents within a group of files with
+   // the same size, either by comparing the files when the group is small, or via
+   // the total hash, in which case --paranoid double-checks the files with the same
+   // hash via byte comparison. Only groups with more than one file are returned. The
+   // reports don't distinguish the two cases, a compared group is reported as having the
+   // same total hash, which it would have, without it being calculated.
+
+   [[nodiscard]] inline std::vector< file_info_group > total_duplicate_groups( const file_info_group& group )
+   {
+      std::vector< file_info_group > result;
+
+      const auto append = [ & ]( const file_info_group& g ){
+         if( g.size() > 1 ) {
+            result.emplace_back( g );
+         }
+      };
+      if( group.size() <= global_compare_args().compare_max ) {
+         for( const auto& g : file_compare( group ).work() ) {
+            append( g );
+         }
+         return result;
+      }
+      std::map< std::string, file_info_group > map;
+
+      for( const auto& fi : group ) {
+         map.try_emplace( fi->total_hash() ).first->second.emplace_back( fi );
+      }
+      for( const auto& sv : map ) {
+         if( global_compare_args().paranoid && ( sv.second.size() > 1 ) ) {
+            for( const auto& g : file_compare( sv.second ).work() ) {
+               append( g );
+            }
+         }
+         else {
+            append( sv.second );
+         }
+      }
+      return result;
+   }
+
+}  // namespace filez
@@ -0,0 +1,56 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+
+#if defined( __linux__ )
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace filez
+{
+   // Returns the physical location of the beginning of the file on its device,
+   // if the OS and filesystem are willing to tell us, i.e. via the FIEMAP ioctl
+   // on Linux and F_LOG2PHYS on macOS; not all filesystems support these.
+
+   [[nodiscard]] inline std::optional< std::uint64_t > physical_offset( const int fd ) noexcept
+   {
+#if defined( __linux__ )
+      alignas( struct fiemap ) char buffer[ sizeof( struct fiemap ) + sizeof( struct fiemap_extent ) ];
+      std::memset( buffer, 0, sizeof( buffer ) );
+
+      auto* map = reinterpret_cast< struct fiemap* >( buffer );
+      map->fm_start = 0;
+      map->fm_length = FIEMAP_MAX_OFFSET;
+      map->fm_extent_count = 1;
+
+      if( ( ::ioctl( fd, FS_IOC_FIEMAP, map ) != 0 ) || ( map->fm_mapped_extents == 0 ) ) {
+         return std::nullopt;
+      }
+      const auto* extent = reinterpret_cast< const struct fiemap_extent* >( buffer + sizeof( struct fiemap ) );
+
+      if( extent->fe_flags & ( FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE ) ) {
+         return std::nullopt;
+      }
+      return extent->fe_physical;
+#elif defined( F_LOG2PHYS )
+      struct log2phys l2p;
+      std::memset( &l2p, 0, sizeof( l2p ) );
+
+      if( ::fcntl( fd, F_LOG2PHYS, &l2p ) != 0 ) {
+         return std::nullopt;
+      }
+      return std::uint64_t( l2p.l2p_devoffset );
+#else
+      (void)fd;
+      return std::nullopt;
+#endif
+   }
+
+}  // namespace filez
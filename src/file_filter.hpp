@@ -0,0 +1,362 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cstddef>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "arguments.hpp"
+#include "file_stat.hpp"
+#include "macros.hpp"
+
+namespace filez
+{
+   // Settings for which directory entries are visited by the directory walks, shared by all tools.
+
+   struct filter_args
+   {
+      std::vector< std::string > exclude;  // Globs for entries to skip, directories are not descended into.
+      std::vector< std::string > exclude_regex;  // Like exclude, searched for in the whole path.
+      std::vector< std::string > include;  // When not empty only regular files that match one of these globs are kept.
+
+      std::size_t min_size = 0;
+      std::size_t max_size = std::size_t( -1 );
+
+      file_time newer = 0;  // Regular files must have been modified at or after this time.
+      file_time older = file_time( -1 );  // Regular files must have been modified before this time.
+
+      bool one_file_system = false;
+   };
+
+   [[nodiscard]] inline filter_args& global_filter_args() noexcept
+   {
+      static filter_args args;
+      return args;
+   }
+
+   // Accepts seconds since the epoch or a local time as YYYY-MM-DD or YYYY-MM-DDTHH:MM:SS.
+
+   [[nodiscard]] inline file_time parse_file_time( const std::string_view v )
+   {
+      if( ( !v.empty() ) && ( v.find_first_not_of( "0123456789" ) == std::string_view::npos ) ) {
+         return file_time( std::stoull( std::string( v ) ) ) * 1000000000;
+      }
+      for( const char* format : { "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d" } ) {
+         std::tm tm = {};
+         std::istringstream iss{ std::string( v ) };
+         iss >> std::get_time( &tm, format );
+
+         if( ( !iss.fail() ) && ( iss.peek() == std::istringstream::traits_type::eof() ) ) {
+            tm.tm_isdst = -1;
+
+            if( const std::time_t t = std::mktime( &tm ); t >= 0 ) {
+               return file_time( t ) * 1000000000;
+            }
+         }
+      }
+      FILEZ_ERROR( "invalid time '" << v << "'" );
+   }
+
+   // Shell-style pattern with '*', '?', '[...]' character classes where a leading '!' or '^'
+   // negates the class, and '\' to escape the next character. A pattern that contains a '/'
+   // is matched against the whole path, where '*' also matches '/', every other pattern is
+   // matched against the file name. Patterns without wildcards are compared directly.
+
+   class file_glob
+   {
+   public:
+      explicit file_glob( const std::string_view pattern )
+         : m_pattern( pattern ),
+           m_literal( pattern.find_first_of( "*?[\\" ) == std::string_view::npos ),
+           m_whole( pattern.find( '/' ) != std::string_view::npos )
+      {}
+
+      [[nodiscard]] bool matches( const std::string_view path, const std::string_view name ) const noexcept
+      {
+         const std::string_view text = m_whole ? path : name;
+         return m_literal ? ( text == m_pattern ) : match( m_pattern, text );
+      }
+
+   private:
+      std::string m_pattern;
+      bool m_literal;
+      bool m_whole;
+
+      // Matches the single character c against the pattern element at p[ i ], sets n to the index of the next element.
+
+      [[nodiscard]] static bool match_one( const std::string_view p, const std::size_t i, const unsigned char c, std::size_t& n ) noexcept
+      {
+         if( p[ i ] == '?' ) {
+            n = i + 1;
+            return true;
+         }
+         if( ( p[ i ] == '\\' ) && ( i + 1 < p.size() ) ) {
+            n = i + 2;
+            return static_cast< unsigned char >( p[ i + 1 ] ) == c;
+         }
+         if( p[ i ] == '[' ) {
+            std::size_t j = i + 1;
+            const bool negated = ( j < p.size() ) && ( ( p[ j ] == '!' ) || ( p[ j ] == '^' ) );
+            j += negated;
+            bool matched = false;
+
+            for( bool first = true; ( j < p.size() ) && ( first || ( p[ j ] != ']' ) ); first = false ) {
+               const unsigned char lo = p[ j ];
+               unsigned char hi = lo;
+
+               if( ( j + 2 < p.size() ) && ( p[ j + 1 ] == '-' ) && ( p[ j + 2 ] != ']' ) ) {
+                  hi = p[ j + 2 ];
+                  j += 3;
+               }
+               else {
+                  ++j;
+               }
+               matched = matched || ( ( lo <= c ) && ( c <= hi ) );
+            }
+            if( j < p.size() ) {
+               n = j + 1;
+               return matched != negated;
+            }
+            // Unterminated class, the '[' is an ordinary character.
+         }
+         n = i + 1;
+         return static_cast< unsigned char >( p[ i ] ) == c;
+      }
+
+      // Iterative matching that only backtracks to the last '*', which is sufficient because
+      // a later '*' can always absorb whatever an earlier one would have matched additionally.
+
+      [[nodiscard]] static bool match( const std::string_view p, const std::string_view t ) noexcept
+      {
+         std::size_t i = 0;
+         std::size_t k = 0;
+         std::size_t star = std::string_view::npos;
+         std::size_t mark = 0;
+
+         while( k < t.size() ) {
+            if( ( i < p.size() ) && ( p[ i ] == '*' ) ) {
+               star = ++i;
+               mark = k;
+               continue;
+            }
+            std::size_t n;
+
+            if( ( i < p.size() ) && match_one( p, i, t[ k ], n ) ) {
+               i = n;
+               ++k;
+               continue;
+            }
+            if( star == std::string_view::npos ) {
+               return false;
+            }
+            i = star;
+            k = ++mark;
+         }
+         while( ( i < p.size() ) && ( p[ i ] == '*' ) ) {
+            ++i;
+         }
+         return i == p.size();
+      }
+   };
+
+   // The compiled form of the filter_args. The exclusions apply to all entries and are checked
+   // before an entry is stat'ed or, for directories, descended into; the other criteria only
+   // apply to regular files and, with the exception of the include globs, need their stat.
+
+   class file_filter
+   {
+   public:
+      explicit file_filter( const filter_args& args )
+         : m_args( args )
+      {
+         for( const auto& g : args.exclude ) {
+            m_exclude.emplace_back( g );
+         }
+         for( const auto& g : args.include ) {
+            m_include.emplace_back( g );
+         }
+         for( const auto& r : args.exclude_regex ) {
+            try {
+               m_exclude_regex.emplace_back( r, std::regex::extended | std::regex::nosubs | std::regex::optimize );
+            }
+            catch( const std::regex_error& e ) {
+               FILEZ_ERROR( "invalid regular expression '" << r << "' -- " << e.what() );
+            }
+         }
+      }
+
+      file_filter( file_filter&& ) = delete;
+      file_filter( const file_filter& ) = delete;
+
+      void operator=( file_filter&& ) = delete;
+      void operator=( const file_filter& ) = delete;
+
+      [[nodiscard]] bool empty() const noexcept
+      {
+         return m_exclude.empty() && m_exclude_regex.empty() && ( !m_args.one_file_system ) && ( !selective() );
+      }
+
+      [[nodiscard]] bool one_file_system() const noexcept
+      {
+         return m_args.one_file_system;
+      }
+
+      // Whether the stat of regular files is needed by selects() and with which fields.
+
+      [[nodiscard]] bool selective() const noexcept
+      {
+         return ( !m_include.empty() ) || ( fields() != stat_type );
+      }
+
+      [[nodiscard]] stat_fields fields() const noexcept
+      {
+         const bool size = ( m_args.min_size > 0 ) || ( m_args.max_size != std::size_t( -1 ) );
+         const bool mtime = ( m_args.newer > 0 ) || ( m_args.older != file_time( -1 ) );
+         return ( size ? stat_size : stat_type ) | ( mtime ? stat_mtime : stat_type );
+      }
+
+      [[nodiscard]] bool excludes( const std::filesystem::path& path ) const
+      {
+         const std::string& p = path.native();
+         const std::string_view n = file_name( p );
+
+         for( const auto& g : m_exclude ) {
+            if( g.matches( p, n ) ) {
+               return true;
+            }
+         }
+         for( const auto& r : m_exclude_regex ) {
+            if( std::regex_search( p, r ) ) {
+               return true;
+            }
+         }
+         return false;
+      }
+
+      // Whether a regular file that was not excluded is kept; other entries are always kept.
+
+      [[nodiscard]] bool selects( const std::filesystem::path& path, const file_stat& stat ) const
+      {
+         if( !stat.is_file() ) {
+            return true;
+         }
+         if( !m_include.empty() ) {
+            const std::string& p = path.native();
+            const std::string_view n = file_name( p );
+            bool found = false;
+
+            for( const auto& g : m_include ) {
+               found = found || g.matches( p, n );
+            }
+            if( !found ) {
+               return false;
+            }
+         }
+         const stat_fields f = fields();
+
+         if( ( f & stat_size ) && ( ( stat.size() < m_args.min_size ) || ( stat.size() > m_args.max_size ) ) ) {
+            return false;
+         }
+         if( ( f & stat_mtime ) && ( ( stat.mtime() < m_args.newer ) || ( stat.mtime() >= m_args.older ) ) ) {
+            return false;
+         }
+         return true;
+      }
+
+   private:
+      const filter_args& m_args;
+
+      std::vector< file_glob > m_exclude;
+      std::vector< file_glob > m_include;
+      std::vector< std::regex > m_exclude_regex;
+
+      [[nodiscard]] static std::string_view file_name( const std::string_view path ) noexcept
+      {
+         const std::size_t i = path.rfind( '/' );
+         return ( i == std::string_view::npos ) ? path : path.substr( i + 1 );
+      }
+   };
+
+   // Compiled on first use, i.e. after the command line arguments were parsed.
+
+   [[nodiscard]] inline const file_filter& global_file_filter()
+   {
+      static const file_filter filter( global_filter_args() );
+      return filter;
+   }
+
+   // Calls f( entry ) for the entries found by the directory iterator I that are not excluded
+   // by the global filter. Excluded directories, and with --one-file-system the directories
+   // on other devices, are not descended into, so nothing below them is read or stat'ed.
+   // With an empty filter this is the same as the plain loop over the iterator.
+
+   template< typename I, typename F >
+   void filtered_walk( const std::filesystem::path& path, F&& f )
+   {
+      const file_filter& filter = global_file_filter();
+
+      if( filter.empty() ) {
+         for( const auto& de : I( path ) ) {
+            f( de );
+         }
+         return;
+      }
+      const auto device = filter.one_file_system() ? file_stat( path, stat_node ).device() : 0;
+
+      for( auto iter = I( path ); iter != I(); ++iter ) {
+         const bool directory = ( !iter->is_symlink() ) && iter->is_directory();
+
+         if( filter.excludes( iter->path() ) ) {
+            if constexpr( std::is_same_v< I, std::filesystem::recursive_directory_iterator > ) {
+               if( directory ) {
+                  iter.disable_recursion_pending();
+               }
+            }
+            continue;
+         }
+         if constexpr( std::is_same_v< I, std::filesystem::recursive_directory_iterator > ) {
+            if( directory && filter.one_file_system() && ( file_stat( iter->path(), stat_node ).device() != device ) ) {
+               iter.disable_recursion_pending();  // The mount point itself is still visited, like find -xdev does.
+            }
+         }
+         f( *iter );
+      }
+   }
+
+   inline void add_filter_args( arguments& args )
+   {
+      args.add_strings( "exclude", global_filter_args().exclude );
+      args.add_strings( "exclude-regex", global_filter_args().exclude_regex );
+      args.add_strings( "include", global_filter_args().include );
+      args.add_size( "min-size", global_filter_args().min_size );
+      args.add_size( "max-size", global_filter_args().max_size );
+      args.add_string( "newer", []( const std::string_view v ){ global_filter_args().newer = parse_file_time( v ); } );
+      args.add_string( "older", []( const std::string_view v ){ global_filter_args().older = parse_file_time( v ); } );
+      args.add_bool( "one-file-system", global_filter_args().one_file_system );
+   }
+
+   inline void print_filter_args_usage()
+   {
+      FILEZ_STDERR( "  Filter options are..." );
+      FILEZ_STDERR( "    --exclude GLOB       to skip entries whose name matches GLOB, or whose path when" );
+      FILEZ_STDERR( "                         GLOB contains a '/', without descending into directories." );
+      FILEZ_STDERR( "    --exclude-regex RE   to skip entries whose path contains a match for RE." );
+      FILEZ_STDERR( "    --include GLOB       to only consider regular files that match one such GLOB." );
+      FILEZ_STDERR( "    --min-size N         to only consider regular files with at least N bytes." );
+      FILEZ_STDERR( "    --max-size N         to only consider regular files with at most N bytes." );
+      FILEZ_STDERR( "    --newer TIME         to only consider files modified at or after TIME." );
+      FILEZ_STDERR( "    --older TIME         to only consider files modified before TIME." );
+      FILEZ_STDERR( "    --one-file-system    to not descend into directories on other filesystems." );
+      FILEZ_STDERR( "  The exclude and include options can be repeated, TIME is in seconds since" );
+      FILEZ_STDERR( "    the epoch or a local time as YYYY-MM-DD or YYYY-MM-DDTHH:MM:SS." );
+   }
+
+}  // namespace filez
@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <optional>
 #include <string>
+#include <tuple>
 #include <utility>
 
 #include "file_stat.hpp"
@@ -23,6 +24,28 @@ namespace filez
          : m_path( path )
       {}
 
+      file_info( const std::filesystem::path& path, const file_stat& stat )
+         : m_path( path ),
+           m_stat( stat )
+      {}
+
+      // The file type is taken from the directory entry, which usually knows it from readdir(3)
+      // without any additional system call, so that is_file() does not need a stat() call.
+
+      explicit file_info( const std::filesystem::directory_entry& entry )
+         : m_path( entry.path() ),
+           m_type( entry.is_symlink() ? std::filesystem::file_type::symlink : ( entry.is_regular_file() ? std::filesystem::file_type::regular : std::filesystem::file_type::unknown ) )
+      {}
+
+      // For when the stat and possibly the hashes are already known, e.g. from a scan snapshot; empty hashes are calculated as usual.
+
+      file_info( const std::filesystem::path& path, const file_stat& stat, std::string&& smart_hash, std::string&& total_hash )
+         : m_path( path ),
+           m_stat( stat ),
+           m_smart_hash( std::move( smart_hash ) ),
+           m_total_hash( std::move( total_hash ) )
+      {}
+
       [[nodiscard]] const std::filesystem::path& path() const noexcept
       {
          return m_path;
@@ -36,6 +59,14 @@ namespace filez
          return m_stat;
       }
 
+      [[nodiscard]] bool is_file()
+      {
+         if( m_type != std::filesystem::file_type::none ) {
+            return m_type == std::filesystem::file_type::regular;
+         }
+         return stat().is_file();
+      }
+
       [[nodiscard]] const std::string& smart_hash()
       {
          if( m_smart_hash.empty() ) {
@@ -48,7 +79,7 @@ namespace filez
       [[nodiscard]] const std::string& total_hash()
       {
          if( m_total_hash.empty() ) {
-            if( ( !m_smart_hash.empty() ) && ( m_smart_hash[ 0 ] != 'P' ) ) {
+            if( ( !m_smart_hash.empty() ) && ( !is_partial_hash( m_smart_hash ) ) ) {
                m_total_hash = m_smart_hash;
             }
             else {
@@ -59,8 +90,35 @@ namespace filez
          return m_total_hash;
       }
 
+      // The hashes calculated so far, empty when not (yet) calculated.
+
+      [[nodiscard]] const std::string& known_smart_hash() const noexcept
+      {
+         return m_smart_hash;
+      }
+
+      [[nodiscard]] const std::string& known_total_hash() const noexcept
+      {
+         return m_total_hash;
+      }
+
+      // For when both hashes are needed, calculates them in a single pass if possible.
+
+      void both_hashes()
+      {
+         if( m_smart_hash.empty() && m_total_hash.empty() ) {
+            const file_open open( m_path );
+            std::tie( m_smart_hash, m_total_hash ) = hash_file_both( m_path, open, stat() );
+         }
+         else {
+            (void)smart_hash();
+            (void)total_hash();
+         }
+      }
+
    private:
       std::filesystem::path m_path;
+      std::filesystem::file_type m_type = std::filesystem::file_type::none;
 
       file_stat m_stat;
 
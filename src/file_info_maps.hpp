@@ -7,6 +7,7 @@
 #include <memory>
 #include <vector>
 
+#include "file_filter.hpp"
 #include "file_info.hpp"
 #include "file_stat.hpp"
 
@@ -29,12 +30,14 @@ namespace filez
    template< typename S, typename I >
    void make_file_info_by_size_map_impl( S& result, const std::filesystem::path& path )
    {
-      for( const auto& de : I( path ) ) {
+      const file_filter& filter = global_file_filter();
+
+      filtered_walk< I >( path, [ & ]( const std::filesystem::directory_entry& de ){
          const auto fi = std::make_shared< file_info >( de.path() );
-         if( fi->stat().is_file() ) {
+         if( fi->stat().is_file() && filter.selects( fi->path(), fi->stat() ) ) {
             result.try_emplace( fi->stat().size() ).first->second.emplace_back( fi );
          }
-      }
+      } );
    }
 
    template< typename S, typename I >
@@ -7,6 +7,7 @@
 #include <set>
 #include <string>
 
+#include "file_filter.hpp"
 #include "file_info.hpp"
 #include "macros.hpp"
 
@@ -28,12 +29,18 @@ namespace filez
    [[nodiscard]] S make_file_info_set_impl( const std::filesystem::path& path )
    {
       S result;
+      const file_filter& filter = global_file_filter();
 
-      for( const auto& de : I( path ) ) {
-         if( !result.emplace( std::make_unique< file_info >( de.path() ) ).second ) {
+      filtered_walk< I >( path, [ & ]( const std::filesystem::directory_entry& de ){
+         auto fi = std::make_unique< file_info >( de.path() );
+
+         if( filter.selective() && ( !filter.selects( fi->path(), fi->stat() ) ) ) {
+            return;
+         }
+         if( !result.emplace( std::move( fi ) ).second ) {
             FILEZ_ERROR( "duplicate file set entry " << de.path() );
          }
-      }
+      } );
       return result;
    }
 
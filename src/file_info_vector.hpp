@@ -2,11 +2,19 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <filesystem>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
+#include "file_filter.hpp"
 #include "file_info.hpp"
+#include "file_stat.hpp"
+#include "macros.hpp"
+#include "root_scan.hpp"
+#include "system.hpp"
 
 namespace filez
 {
@@ -16,10 +24,16 @@ namespace filez
    [[nodiscard]] inline file_info_vector make_file_info_vector_impl( const std::filesystem::path& path )
    {
       L result;
+      const file_filter& filter = global_file_filter();
 
-      for( const auto& de : I( path ) ) {
-         result.emplace_back( std::make_shared< file_info >( de.path() ) );
-      }
+      filtered_walk< I >( path, [ & ]( const std::filesystem::directory_entry& de ){
+         auto fi = std::make_shared< file_info >( de );
+
+         if( filter.selective() && fi->is_file() && ( !filter.selects( fi->path(), fi->stat() ) ) ) {
+            return;
+         }
+         result.emplace_back( std::move( fi ) );
+      } );
       return result;
    }
 
@@ -33,4 +47,107 @@ namespace filez
       return make_file_info_vector_impl< file_info_vector, std::filesystem::recursive_directory_iterator >( path );
    }
 
+   // Two-pass alternative for when only regular files that share their size with another
+   // file are of interest. The first pass only counts how often every size occurs, up to
+   // two, the second pass only creates the file_info objects for the files whose size
+   // occurs at least twice, so that memory use grows with the number of candidates
+   // rather than with the total number of files.
+
+   struct size_scan_stats
+   {
+      std::size_t files = 0;  // Regular files seen in the first pass.
+      std::size_t skipped = 0;  // Regular files for which no file_info was created in the second pass.
+   };
+
+   using size_scan_counts = std::unordered_map< std::size_t, unsigned char >;
+
+   template< typename I >
+   void count_file_sizes_impl( const std::filesystem::path& path, size_scan_counts& counts, size_scan_stats& stats )
+   {
+      const file_filter& filter = global_file_filter();
+
+      filtered_walk< I >( path, [ & ]( const std::filesystem::directory_entry& de ){
+         if( de.is_symlink() || ( !de.is_regular_file() ) ) {
+            return;  // Usually known from the directory entry without a stat() call.
+         }
+         if( const file_stat st( de.path(), stat_size | filter.fields() ); st.is_file() && filter.selects( de.path(), st ) ) {
+            unsigned char& count = counts[ st.size() ];
+            count = std::min( count + 1, 2 );
+            ++stats.files;
+         }
+      } );
+   }
+
+   template< typename I >
+   void make_size_pruned_file_info_vector_impl( file_info_vector& result, const std::filesystem::path& path, const size_scan_counts& counts, size_scan_stats& stats )
+   {
+      const file_filter& filter = global_file_filter();
+
+      filtered_walk< I >( path, [ & ]( const std::filesystem::directory_entry& de ){
+         if( de.is_symlink() || ( !de.is_regular_file() ) ) {
+            return;
+         }
+         if( const file_stat st( de.path() ); st.is_file() && filter.selects( de.path(), st ) ) {
+            if( const auto iter = counts.find( st.size() ); ( iter != counts.end() ) && ( iter->second > 1 ) ) {
+               result.emplace_back( std::make_shared< file_info >( de.path(), st ) );
+            }
+            else {
+               ++stats.skipped;
+            }
+         }
+      } );
+   }
+
+   [[nodiscard]] inline file_info_vector make_size_pruned_file_info_vector( const std::vector< std::filesystem::path >& paths, const bool recursive, size_scan_stats& stats )
+   {
+      if( paths.empty() ) {
+         return file_info_vector();
+      }
+      // Both passes walk the roots concurrently, the partial results are merged in the order of the roots.
+
+      std::vector< size_scan_counts > counts( paths.size() );
+      std::vector< size_scan_stats > parts( paths.size() );
+
+      for_each_root_concurrently( paths, [ & ]( const std::size_t i ){
+         if( recursive ) {
+            count_file_sizes_impl< std::filesystem::recursive_directory_iterator >( paths[ i ], counts[ i ], parts[ i ] );
+         }
+         else {
+            count_file_sizes_impl< std::filesystem::directory_iterator >( paths[ i ], counts[ i ], parts[ i ] );
+         }
+      } );
+      for( std::size_t i = 1; i < counts.size(); ++i ) {
+         for( const auto& [ size, count ] : counts[ i ] ) {
+            unsigned char& c = counts.front()[ size ];
+            c = std::min( c + count, 2 );
+         }
+         counts[ i ].clear();
+      }
+      std::vector< file_info_vector > lists( paths.size() );
+
+      for_each_root_concurrently( paths, [ & ]( const std::size_t i ){
+         if( recursive ) {
+            make_size_pruned_file_info_vector_impl< std::filesystem::recursive_directory_iterator >( lists[ i ], paths[ i ], counts.front(), parts[ i ] );
+         }
+         else {
+            make_size_pruned_file_info_vector_impl< std::filesystem::directory_iterator >( lists[ i ], paths[ i ], counts.front(), parts[ i ] );
+         }
+      } );
+      file_info_vector result;
+
+      for( std::size_t i = 0; i < paths.size(); ++i ) {
+         result.insert( result.end(), lists[ i ].begin(), lists[ i ].end() );
+         stats.files += parts[ i ].files;
+         stats.skipped += parts[ i ].skipped;
+      }
+      return result;
+   }
+
+   inline void print_size_scan_stats( const size_scan_stats& stats )
+   {
+      FILEZ_STDOUT( "Files scanned: " << stats.files );
+      FILEZ_STDOUT( "File records skipped: " << stats.skipped );
+      FILEZ_STDOUT( "Peak memory: " << ( peak_memory_usage() / 1024 ) << " KiB" );
+   }
+
 }  // namespace filez
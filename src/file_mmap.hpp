@@ -97,6 +97,13 @@ namespace filez
          FILEZ_ASSERT( ::posix_madvise( m_data, m_size, POSIX_MADV_WILLNEED ) == 0 );
       }
 
+      void will_need( const std::size_t offset, const std::size_t size ) const noexcept
+      {
+         // Only a hint, the kernel starts reading the range in the background.
+
+         (void)::posix_madvise( m_data + offset, size, POSIX_MADV_WILLNEED );
+      }
+
    private:
       char* m_data = nullptr;
       std::size_t m_size = 0;
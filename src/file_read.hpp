@@ -0,0 +1,171 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "file_stat.hpp"
+#include "io_stats.hpp"
+#include "macros.hpp"
+#include "page_cache.hpp"
+#include "system.hpp"
+
+namespace filez
+{
+   // Alternative to file_mmap for bulk reading that tries hard to leave the page cache as it was:
+   // O_DIRECT (or F_NOCACHE on macOS) with page-aligned buffers where the filesystem supports it,
+   // otherwise normal reads followed by POSIX_FADV_DONTNEED for all pages that were not already
+   // resident before we read them -- pages that somebody else is using are never dropped.
+
+   class file_read
+   {
+   public:
+      static constexpr std::size_t buffer_size = 1024 * 1024;
+
+      file_read( const std::filesystem::path& path, const file_stat& stat )
+         : m_path( path ),
+           m_size( stat.size() ),
+           m_buffer( static_cast< char* >( std::aligned_alloc( get_pagesize(), rounded_up_to_pagesize( buffer_size ) ) ) )
+      {
+         if( !stat.is_file() ) {
+            FILEZ_ERROR( "unable to read() path " << path << " -- is not regular file" );
+         }
+         if( !m_buffer ) {
+            FILEZ_ERROR( "unable to allocate read buffer for path " << path );
+         }
+#if defined( O_DIRECT )
+         m_fd = ::open( path.c_str(), O_RDONLY | O_DIRECT );
+         m_direct = ( m_fd >= 0 );
+#endif
+         if( m_fd < 0 ) {
+            m_fd = ::open( path.c_str(), O_RDONLY );
+         }
+         if( m_fd < 0 ) {
+            FILEZ_ERRNO( "unable to open() path [ " << path << " ] for reading" );
+         }
+#if defined( F_NOCACHE )
+         m_direct = ( ::fcntl( m_fd, F_NOCACHE, 1 ) == 0 );
+#endif
+      }
+
+      ~file_read()
+      {
+         ::close( m_fd );
+      }
+
+      file_read( file_read&& ) = delete;
+      file_read( const file_read& ) = delete;
+
+      void operator=( file_read&& ) = delete;
+      void operator=( const file_read& ) = delete;
+
+      [[nodiscard]] std::size_t size() const noexcept
+      {
+         return m_size;
+      }
+
+      // Calls f( data, size ) for consecutive pieces of the requested range.
+
+      template< typename F >
+      void read( const std::size_t offset, const std::size_t size, F&& f )
+      {
+         const std::size_t end = std::min( offset + size, m_size );
+
+         for( std::size_t pos = rounded_down_to_pagesize( offset ); pos < end; ) {
+            const std::size_t want = std::min( buffer_size, rounded_up_to_pagesize( end - pos ) );
+            const std::size_t resident = resident_pages( m_fd, pos, std::min( want, m_size - pos ), m_pages );
+            const std::size_t got = read_impl( pos, want );
+
+            global_io_stats().bytes_read += got;
+            global_io_stats().bytes_cached += std::min( got, resident * get_pagesize() );
+
+            if( ( !m_direct ) && ( resident < m_pages.size() ) ) {
+               drop_pages( pos );
+            }
+            // A short read can end before the requested offset; the next read continues there, or
+            // reports the unexpected end of the file.
+
+            if( const std::size_t skip = ( offset > pos ) ? ( offset - pos ) : 0; got > skip ) {
+               f( static_cast< const char* >( m_buffer.get() + skip ), std::min( got, end - pos ) - skip );
+            }
+            pos += got;
+         }
+      }
+
+   private:
+      struct buffer_free
+      {
+         void operator()( char* buffer ) const noexcept
+         {
+            std::free( buffer );
+         }
+      };
+
+      const std::filesystem::path m_path;
+      const std::size_t m_size;
+
+      int m_fd = -1;
+      bool m_direct = false;
+      const std::unique_ptr< char, buffer_free > m_buffer;
+      std::vector< unsigned char > m_pages;
+
+      [[nodiscard]] std::size_t read_impl( const std::size_t pos, const std::size_t want )
+      {
+         while( true ) {
+            errno = 0;
+            const ::ssize_t got = ::pread( m_fd, m_buffer.get(), want, pos );
+
+            if( got > 0 ) {
+               return std::size_t( got );
+            }
+            if( got == 0 ) {
+               FILEZ_ERROR( "unexpected end of file for path " << m_path << " at offset " << pos );
+            }
+            if( errno == EINTR ) {
+               continue;
+            }
+#if defined( O_DIRECT )
+            if( m_direct && ( errno == EINVAL ) ) {
+               // Some filesystems accept O_DIRECT for open() but not for the actual read.
+               if( ::fcntl( m_fd, F_SETFL, ::fcntl( m_fd, F_GETFL ) & ~O_DIRECT ) == 0 ) {
+                  m_direct = false;
+                  continue;
+               }
+            }
+#endif
+            FILEZ_ERRNO( "unable to pread() path " << m_path << " at offset " << pos );
+         }
+      }
+
+      void drop_pages( const std::size_t pos )
+      {
+         const std::size_t page = get_pagesize();
+
+         for( std::size_t i = 0; i < m_pages.size(); ) {
+            if( m_pages[ i ] ) {
+               ++i;
+               continue;
+            }
+            std::size_t j = i + 1;
+
+            while( ( j < m_pages.size() ) && ( !m_pages[ j ] ) ) {
+               ++j;
+            }
+#if defined( POSIX_FADV_DONTNEED )
+            (void)::posix_fadvise( m_fd, pos + i * page, ( j - i ) * page, POSIX_FADV_DONTNEED );
+#endif
+            i = j;
+         }
+      }
+   };
+
+}  // namespace filez
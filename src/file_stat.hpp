@@ -4,6 +4,7 @@
 
 #include <compare>
 #include <cstring>
+#include <fcntl.h>
 #include <filesystem>
 #include <functional>
 #include <unistd.h>
@@ -12,6 +13,10 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#if !defined( __APPLE__ )
+#include <sys/sysmacros.h>
+#endif
+
 #include "file_open.hpp"
 #include "macros.hpp"
 
@@ -20,6 +25,32 @@ namespace filez
    using file_time = __uint128_t;
    using file_node = std::pair< ::dev_t, ::ino_t >;
 
+   struct stat_args
+   {
+      bool dont_sync = false;  // Accept cached attributes on network filesystems, Linux only.
+   };
+
+   [[nodiscard]] inline stat_args& global_stat_args() noexcept
+   {
+      static stat_args args;
+      return args;
+   }
+
+   // The fields of a file_stat that are actually needed; on Linux only these are requested
+   // with statx(2), which can save work for the filesystem, in particular for NFS and FUSE,
+   // while elsewhere lstat(2) always fills in everything. The type and the owner, for the
+   // same_user() check, are always included, the accessors for all other fields must only
+   // be used when the field was requested.
+
+   using stat_fields = unsigned;
+
+   constexpr stat_fields stat_type = 0;
+   constexpr stat_fields stat_size = 1;
+   constexpr stat_fields stat_links = 2;
+   constexpr stat_fields stat_node = 4;
+   constexpr stat_fields stat_mtime = 8;
+   constexpr stat_fields stat_all = stat_size | stat_links | stat_node | stat_mtime;
+
    class file_stat
    {
    public:
@@ -28,25 +59,50 @@ namespace filez
          std::memset( &m_file_stat, 0, sizeof( m_file_stat ) );
       }
 
-      explicit file_stat( const std::filesystem::path& path )
+      explicit file_stat( const std::filesystem::path& path, const stat_fields fields = stat_all )
+      {
+         update( path, fields );
+      }
+
+      // For a stat that was recorded earlier, e.g. in a scan snapshot, see scan_snapshot.hpp.
+
+      file_stat( const ::mode_t type, const std::size_t size, const std::size_t links, const file_node node, const file_time mtime ) noexcept
+         : file_stat()
       {
-         update( path );
+         m_file_stat.st_mode = type;
+         m_file_stat.st_size = ::off_t( size );
+         m_file_stat.st_nlink = links;
+         m_file_stat.st_dev = node.first;
+         m_file_stat.st_ino = node.second;
+#if defined( __APPLE__ )
+         m_file_stat.st_mtimespec.tv_sec = ::time_t( mtime / 1000000000 );
+         m_file_stat.st_mtimespec.tv_nsec = long( mtime % 1000000000 );
+#else
+         m_file_stat.st_mtim.tv_sec = ::time_t( mtime / 1000000000 );
+         m_file_stat.st_mtim.tv_nsec = long( mtime % 1000000000 );
+#endif
+         m_valid = true;
       }
 
-      void update( const std::filesystem::path& path )
+      void update( const std::filesystem::path& path, const stat_fields fields = stat_all )
       {
+#if defined( STATX_BASIC_STATS ) && defined( AT_STATX_DONT_SYNC )
+         update_statx( path, fields );
+#else
+         (void)fields;
          if( ::lstat( path.c_str(), &m_file_stat ) ) {
             FILEZ_ERRNO( "unable to lstat(2) path " << path );
          }
+#endif
          if( !same_user() ) {
             FILEZ_ERROR( "path " << path << " does not belong to user " << ::getuid() );
          }
-         FILEZ_ASSERT( is_valid() );
+         m_valid = true;
       }
 
       [[nodiscard]] bool is_valid() const noexcept
       {
-         return links() > 0;  // TODO: Is this good enough or do we need to do The Right Thing and use std::optional< file_stat > instead of having a default c'tor?
+         return m_valid;
       }
 
       [[nodiscard]] auto type() const noexcept
@@ -79,6 +135,15 @@ namespace filez
          return m_file_stat.st_nlink;
       }
 
+      [[nodiscard]] file_time mtime() const noexcept
+      {
+#if defined( __APPLE__ )
+         return file_time( m_file_stat.st_mtimespec.tv_sec ) * 1000000000 + m_file_stat.st_mtimespec.tv_nsec;
+#else
+         return file_time( m_file_stat.st_mtim.tv_sec ) * 1000000000 + m_file_stat.st_mtim.tv_nsec;
+#endif
+      }
+
       // The C++17 filesystem library only contains a function that checks whether
       // two file stats refer to the same file, but it doesn't contain a function to
       // get at the underlying data which we need to stick in a std::map or similar:
@@ -100,6 +165,34 @@ namespace filez
 
    protected:
       struct ::stat m_file_stat;
+      bool m_valid = false;
+
+#if defined( STATX_BASIC_STATS ) && defined( AT_STATX_DONT_SYNC )
+      void update_statx( const std::filesystem::path& path, const stat_fields fields )
+      {
+         unsigned mask = STATX_TYPE | STATX_UID;
+         mask |= ( fields & stat_size ) ? STATX_SIZE : 0;
+         mask |= ( fields & stat_links ) ? STATX_NLINK : 0;
+         mask |= ( fields & stat_node ) ? STATX_INO : 0;
+         mask |= ( fields & stat_mtime ) ? STATX_MTIME : 0;
+
+         const int flags = AT_SYMLINK_NOFOLLOW | ( global_stat_args().dont_sync ? AT_STATX_DONT_SYNC : AT_STATX_SYNC_AS_STAT );
+         struct ::statx stx;
+
+         if( ::statx( AT_FDCWD, path.c_str(), flags, mask, &stx ) ) {
+            FILEZ_ERRNO( "unable to statx(2) path " << path );
+         }
+         std::memset( &m_file_stat, 0, sizeof( m_file_stat ) );
+         m_file_stat.st_mode = stx.stx_mode;
+         m_file_stat.st_uid = stx.stx_uid;
+         m_file_stat.st_size = ::off_t( stx.stx_size );
+         m_file_stat.st_nlink = stx.stx_nlink;
+         m_file_stat.st_dev = makedev( stx.stx_dev_major, stx.stx_dev_minor );
+         m_file_stat.st_ino = stx.stx_ino;
+         m_file_stat.st_mtim.tv_sec = stx.stx_mtime.tv_sec;
+         m_file_stat.st_mtim.tv_nsec = stx.stx_mtime.tv_nsec;
+      }
+#endif
 
       [[nodiscard]] bool same_user() const noexcept
       {
@@ -0,0 +1,215 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "file_stat.hpp"
+#include "macros.hpp"
+#include "system.hpp"
+
+namespace filez
+{
+   // Alternative to file_mmap that overlaps reading and hashing: a reader thread fills
+   // a ring of buffers with pread() while the calling thread hashes the filled buffers,
+   // so that the CPU isn't idle while waiting for the disk and vice versa.
+
+   class file_stream
+   {
+   public:
+      file_stream( const std::filesystem::path& path, const file_stat& stat, const std::size_t chunk_size, const std::size_t buffers )
+         : m_path( path ),
+           m_size( stat.size() ),
+           m_chunk_size( rounded_up_to_pagesize( std::max< std::size_t >( chunk_size, 1 ) ) ),
+           m_buffers( std::max< std::size_t >( buffers, 2 ) ),
+           m_fd( ::open( path.c_str(), O_RDONLY ) )
+      {
+         if( !stat.is_file() ) {
+            ::close( m_fd );
+            FILEZ_ERROR( "unable to read() path " << path << " -- is not regular file" );
+         }
+         if( m_fd < 0 ) {
+            FILEZ_ERRNO( "unable to open() path [ " << path << " ] for reading" );
+         }
+#if defined( POSIX_FADV_SEQUENTIAL )
+         (void)::posix_fadvise( m_fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+      }
+
+      ~file_stream()
+      {
+         ::close( m_fd );
+      }
+
+      file_stream( file_stream&& ) = delete;
+      file_stream( const file_stream& ) = delete;
+
+      void operator=( file_stream&& ) = delete;
+      void operator=( const file_stream& ) = delete;
+
+      [[nodiscard]] std::size_t size() const noexcept
+      {
+         return m_size;
+      }
+
+      // Calls f( data, size ) for consecutive pieces of the requested range.
+
+      template< typename F >
+      void read( const std::size_t offset, const std::size_t size, F&& f )
+      {
+         const std::size_t end = std::min( offset + size, m_size );
+
+         if( offset >= end ) {
+            return;
+         }
+         if( end - offset <= m_chunk_size ) {
+            // Not worth starting a thread, e.g. for the chunks of the smart hash.
+            const std::unique_ptr< char[] > buffer = std::make_unique< char[] >( end - offset );
+            read_impl( buffer.get(), offset, end - offset );
+            f( static_cast< const char* >( buffer.get() ), end - offset );
+            return;
+         }
+         pipeline p( m_buffers, m_chunk_size );
+         const std::size_t chunks = ( end - offset + m_chunk_size - 1 ) / m_chunk_size;
+
+         std::thread reader( [ & ](){
+            try {
+               for( std::size_t k = 0; k < chunks; ++k ) {
+                  char* buffer = p.wait_for_free( k );
+
+                  if( buffer == nullptr ) {
+                     return;  // The hashing side gave up.
+                  }
+                  const std::size_t pos = offset + k * m_chunk_size;
+                  read_impl( buffer, pos, std::min( m_chunk_size, end - pos ) );
+                  p.produced_one();
+               }
+            }
+            catch( ... ) {
+               p.fail( std::current_exception() );
+            }
+         } );
+         try {
+            for( std::size_t k = 0; k < chunks; ++k ) {
+               const char* buffer = p.wait_for_full( k );
+               const std::size_t pos = offset + k * m_chunk_size;
+               f( buffer, std::min( m_chunk_size, end - pos ) );
+               p.consumed_one();
+            }
+         }
+         catch( ... ) {
+            p.stop();
+            reader.join();
+            throw;
+         }
+         reader.join();
+      }
+
+   private:
+      const std::filesystem::path m_path;
+      const std::size_t m_size;
+      const std::size_t m_chunk_size;
+      const std::size_t m_buffers;
+
+      int m_fd;
+
+      class pipeline
+      {
+      public:
+         pipeline( const std::size_t buffers, const std::size_t chunk_size )
+         {
+            for( std::size_t i = 0; i < buffers; ++i ) {
+               m_buffers.emplace_back( std::make_unique< char[] >( chunk_size ) );
+            }
+         }
+
+         [[nodiscard]] char* wait_for_free( const std::size_t k )
+         {
+            std::unique_lock lock( m_mutex );
+            m_condition.wait( lock, [ & ](){ return m_stopped || ( k - m_consumed < m_buffers.size() ); } );
+            return m_stopped ? nullptr : m_buffers[ k % m_buffers.size() ].get();
+         }
+
+         [[nodiscard]] const char* wait_for_full( const std::size_t k )
+         {
+            std::unique_lock lock( m_mutex );
+            m_condition.wait( lock, [ & ](){ return m_error || ( k < m_produced ); } );
+
+            if( m_error ) {
+               std::rethrow_exception( m_error );
+            }
+            return m_buffers[ k % m_buffers.size() ].get();
+         }
+
+         void produced_one()
+         {
+            const std::lock_guard lock( m_mutex );
+            ++m_produced;
+            m_condition.notify_all();
+         }
+
+         void consumed_one()
+         {
+            const std::lock_guard lock( m_mutex );
+            ++m_consumed;
+            m_condition.notify_all();
+         }
+
+         void fail( std::exception_ptr&& e )
+         {
+            const std::lock_guard lock( m_mutex );
+            m_error = std::move( e );
+            m_condition.notify_all();
+         }
+
+         void stop()
+         {
+            const std::lock_guard lock( m_mutex );
+            m_stopped = true;
+            m_condition.notify_all();
+         }
+
+      private:
+         std::mutex m_mutex;
+         std::condition_variable m_condition;
+         std::vector< std::unique_ptr< char[] > > m_buffers;
+         std::size_t m_produced = 0;
+         std::size_t m_consumed = 0;
+         std::exception_ptr m_error;
+         bool m_stopped = false;
+      };
+
+      void read_impl( char* buffer, const std::size_t pos, const std::size_t want ) const
+      {
+         for( std::size_t done = 0; done < want; ) {
+            errno = 0;
+            const ::ssize_t got = ::pread( m_fd, buffer + done, want - done, ::off_t( pos + done ) );
+
+            if( got > 0 ) {
+               done += std::size_t( got );
+               continue;
+            }
+            if( got == 0 ) {
+               FILEZ_ERROR( "unexpected end of file for path " << m_path << " at offset " << ( pos + done ) );
+            }
+            if( errno != EINTR ) {
+               FILEZ_ERRNO( "unable to pread() path " << m_path << " at offset " << ( pos + done ) );
+            }
+         }
+      }
+   };
+
+}  // namespace filez
@@ -0,0 +1,40 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+#include <sys/types.h>
+#include <sys/xattr.h>
+
+namespace filez
+{
+   // Failures are not errors since many filesystems don't support user extended
+   // attributes, or they might not be writable, in which case we simply hash.
+
+   [[nodiscard]] inline std::optional< std::string > get_xattr( const int fd, const char* name )
+   {
+      char buffer[ 256 ];
+#if defined( __APPLE__ )
+      const ::ssize_t size = ::fgetxattr( fd, name, buffer, sizeof( buffer ), 0, 0 );
+#else
+      const ::ssize_t size = ::fgetxattr( fd, name, buffer, sizeof( buffer ) );
+#endif
+      if( size < 0 ) {
+         return std::nullopt;
+      }
+      return std::string( buffer, std::size_t( size ) );
+   }
+
+   inline bool set_xattr( const int fd, const char* name, const std::string& value ) noexcept
+   {
+#if defined( __APPLE__ )
+      return ::fsetxattr( fd, name, value.data(), value.size(), 0, 0 ) == 0;
+#else
+      return ::fsetxattr( fd, name, value.data(), value.size(), 0 ) == 0;
+#endif
+   }
+
+}  // namespace filez
@@ -9,7 +9,9 @@
 
 #include <sys/types.h>
 
+#include "file_filter.hpp"
 #include "macros.hpp"
+#include "utility.hpp"
 
 namespace filez
 {
@@ -46,4 +48,21 @@ namespace filez
       ::close( fd );
    }
 
+   // Creates the directory hierarchy below from under to, without the directories that are
+   // excluded by the global file filter, or that are below them.
+
+   inline void copy_directories( const std::filesystem::path& from, const std::filesystem::path& to )
+   {
+      if( global_file_filter().empty() ) {
+         constexpr auto opts = std::filesystem::copy_options::recursive | std::filesystem::copy_options::directories_only | std::filesystem::copy_options::skip_symlinks;
+         std::filesystem::copy( from, to, opts );  // TODO: This is slower than expected, optimise?
+         return;
+      }
+      filtered_walk< std::filesystem::recursive_directory_iterator >( from, [ & ]( const std::filesystem::directory_entry& de ){
+         if( ( !de.is_symlink() ) && de.is_directory() ) {
+            std::filesystem::create_directory( transfer( de.path(), from, to ), de.path() );
+         }
+      } );
+   }
+
 } // filez
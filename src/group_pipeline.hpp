@@ -0,0 +1,260 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "file_compare.hpp"
+#include "file_info.hpp"
+#include "file_info_vector.hpp"
+#include "file_stat.hpp"
+#include "hash_schedule.hpp"
+
+namespace filez
+{
+   // The keys by which files can be grouped, the cost orders them from cheapest to most
+   // expensive to obtain. Keys that need hashing schedule the hashing for all files in
+   // the groups that reach their stage, see schedule_hashing() for the options.
+
+   struct size_key
+   {
+      static constexpr unsigned cost = 0;
+
+      [[nodiscard]] static std::size_t get( file_info& fi )
+      {
+         return fi.stat().size();
+      }
+   };
+
+   struct name_key
+   {
+      static constexpr unsigned cost = 1;
+
+      [[nodiscard]] static std::filesystem::path get( file_info& fi )
+      {
+         return fi.path().filename();
+      }
+   };
+
+   struct node_key
+   {
+      static constexpr unsigned cost = 2;
+
+      [[nodiscard]] static file_node get( file_info& fi )
+      {
+         return fi.stat().node();
+      }
+   };
+
+   struct smart_hash_key
+   {
+      static constexpr unsigned cost = 3;
+
+      [[nodiscard]] static std::string get( file_info& fi )
+      {
+         return fi.smart_hash();
+      }
+
+      static void schedule( const std::vector< file_info_group >& groups )
+      {
+         schedule_group_hashing( groups, []( const file_info_group& ){ return true; }, []( file_info& fi ){ (void)fi.smart_hash(); } );
+      }
+   };
+
+   struct total_hash_key
+   {
+      static constexpr unsigned cost = 4;
+
+      [[nodiscard]] static std::string get( file_info& fi )
+      {
+         return fi.total_hash();
+      }
+
+      static void schedule( const std::vector< file_info_group >& groups )
+      {
+         schedule_group_hashing( groups, []( const file_info_group& ){ return true; }, []( file_info& fi ){ (void)fi.total_hash(); } );
+      }
+   };
+
+   // Same contents as determined by total_duplicate_groups(), i.e. by byte comparison for small
+   // groups and the total hash otherwise; only yields groups with more than one file.
+
+   struct contents_key
+   {
+      static constexpr unsigned cost = 4;
+
+      static void schedule( const std::vector< file_info_group >& groups )
+      {
+         // Small groups are compared by file_compare rather than hashed.
+
+         schedule_group_hashing( groups, []( const file_info_group& group ){ return group.size() > global_compare_args().compare_max; }, []( file_info& fi ){ (void)fi.total_hash(); } );
+      }
+
+      template< typename F >
+      static void partition( const file_info_group& group, F&& f )
+      {
+         for( auto& g : total_duplicate_groups( group ) ) {
+            f( std::move( g ) );
+         }
+      }
+   };
+
+   // Calls f for the sub-groups of a group with the same key K in the order of the key,
+   // retaining the order of the files.
+
+   template< typename K, typename F >
+   void partition_group( const file_info_group& group, F&& f )
+   {
+      if constexpr( requires{ K::partition( group, f ); } ) {
+         K::partition( group, f );
+      }
+      else {
+         std::map< std::decay_t< decltype( K::get( *group.front() ) ) >, file_info_group > map;
+
+         for( const auto& fi : group ) {
+            map.try_emplace( K::get( *fi ) ).first->second.emplace_back( fi );
+         }
+         for( auto& kv : map ) {
+            f( std::move( kv.second ) );
+         }
+      }
+   }
+
+   // Whether partitioning the group by key K would yield more than one sub-group.
+
+   template< typename K >
+   [[nodiscard]] bool has_variation( const file_info_group& group )
+   {
+      const auto k = K::get( *group.front() );
+      return std::any_of( group.begin() + 1, group.end(), [ & ]( const auto& fi ){ return K::get( *fi ) != k; } );
+   }
+
+   struct no_variation
+   {
+      static constexpr unsigned cost = unsigned( -1 );
+   };
+
+   // Groups the added regular files by all Keys, one stage per key in the order of increasing
+   // cost regardless of the order in which the keys are given. After every stage the groups
+   // with a single file are dropped, so that expensive keys are only obtained for files that
+   // share all cheaper keys with at least one other file. The resulting groups are ordered
+   // by the keys in the order of the stages, and the files within each group by the order
+   // in which they were added.
+
+   template< typename... Keys >
+   class group_pipeline
+   {
+   public:
+      group_pipeline() noexcept = default;
+
+      group_pipeline( group_pipeline&& ) = delete;
+      group_pipeline( const group_pipeline& ) = delete;
+
+      void operator=( group_pipeline&& ) = delete;
+      void operator=( const group_pipeline& ) = delete;
+
+      void add( const file_info_vector& list )
+      {
+         for( const auto& sp : list ) {
+            if( sp->is_file() ) {
+               m_files.emplace_back( sp );
+            }
+         }
+      }
+
+      // Returns all groups with more than one file that agree on all keys; clears the added files.
+
+      [[nodiscard]] std::vector< file_info_group > groups()
+      {
+         return stages< no_variation >();
+      }
+
+      // Returns, for all groups with more than one file that agree on all keys and that
+      // contain files with different keys V, the partition of the group by V. Groups without
+      // variation are also dropped before every stage whose key is more expensive than V.
+
+      template< typename V >
+      [[nodiscard]] std::vector< std::vector< file_info_group > > variations()
+      {
+         std::vector< std::vector< file_info_group > > result;
+
+         for( const auto& group : stages< V >() ) {
+            std::vector< file_info_group > parts;
+            partition_group< V >( group, [ & ]( file_info_group&& g ){ parts.emplace_back( std::move( g ) ); } );
+
+            if( parts.size() > 1 ) {
+               result.emplace_back( std::move( parts ) );
+            }
+         }
+         return result;
+      }
+
+   private:
+      file_info_group m_files;
+
+      static_assert( sizeof...( Keys ) > 0 );
+
+      static constexpr std::array< unsigned, sizeof...( Keys ) > costs = [](){
+         std::array< unsigned, sizeof...( Keys ) > result = { Keys::cost... };
+         std::sort( result.begin(), result.end() );
+         return result;
+      }();
+
+      static_assert( std::adjacent_find( costs.begin(), costs.end() ) == costs.end(), "keys must have different costs" );
+
+      template< typename V >
+      [[nodiscard]] std::vector< file_info_group > stages()
+      {
+         std::vector< file_info_group > groups;
+
+         if( m_files.size() > 1 ) {
+            groups.emplace_back( std::move( m_files ) );
+         }
+         m_files.clear();
+         stages_impl< V >( groups, std::make_index_sequence< sizeof...( Keys ) >() );
+         return groups;
+      }
+
+      template< typename V, std::size_t... Is >
+      static void stages_impl( std::vector< file_info_group >& groups, std::index_sequence< Is... > )
+      {
+         ( stage_by_cost< V, costs[ Is ] >( groups ), ... );
+      }
+
+      template< typename V, unsigned C >
+      static void stage_by_cost( std::vector< file_info_group >& groups )
+      {
+         ( ( ( Keys::cost == C ) ? stage< V, Keys >( groups ) : void() ), ... );
+      }
+
+      template< typename V, typename K >
+      static void stage( std::vector< file_info_group >& groups )
+      {
+         if constexpr( K::cost > V::cost ) {
+            std::erase_if( groups, []( const file_info_group& group ){ return !has_variation< V >( group ); } );
+         }
+         if constexpr( requires{ K::schedule( groups ); } ) {
+            K::schedule( groups );
+         }
+         std::vector< file_info_group > next;
+
+         for( const auto& group : groups ) {
+            partition_group< K >( group, [ & ]( file_info_group&& g ){
+               if( g.size() > 1 ) {
+                  next.emplace_back( std::move( g ) );
+               }
+            } );
+         }
+         groups.swap( next );
+      }
+   };
+
+}  // namespace filez
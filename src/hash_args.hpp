@@ -0,0 +1,98 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "arguments.hpp"
+#include "hash_size.hpp"
+#include "macros.hpp"
+
+namespace filez
+{
+   // Settings for the hashing functions in hash_file.hpp that are shared by all tools.
+
+   struct hash_args
+   {
+      std::string algorithm = "sha256";
+      std::size_t hash_threads = 1;
+      std::size_t samples = 0;  // Per doubling of the file size, 0 for the classic 'P' smart hash.
+
+      bool cache_neutral = false;
+
+      bool stream = false;
+      std::size_t chunk_size = 1024 * 1024;
+      std::size_t buffers = 2;
+
+      bool resident_first = false;
+      bool physical_order = false;
+
+      std::size_t cache_limit = 256;  // MiB per hash cache.
+      bool hash_stats = false;
+      bool xattr = false;
+
+      bool io_queues = false;
+      std::size_t ssd_depth = 4;
+      std::size_t hdd_depth = 1;
+   };
+
+   [[nodiscard]] inline hash_args& global_hash_args() noexcept
+   {
+      static hash_args args;
+      return args;
+   }
+
+   [[nodiscard]] inline bool is_hash_algorithm( const std::string_view name ) noexcept
+   {
+      return ( name == "sha256" ) || ( name == "blake3" ) || ( name == "xxh3" );
+   }
+
+   inline void add_hash_args( arguments& args )
+   {
+      args.add_string( "hash", []( const std::string_view v ){
+         if( !is_hash_algorithm( v ) ) {
+            FILEZ_ERROR( "unknown hash algorithm '" << v << "'" );
+         }
+         global_hash_args().algorithm = v;
+      } );
+      args.add_size( "hash-threads", global_hash_args().hash_threads );
+      args.add_size( "samples", global_hash_args().samples );
+      args.add_string( "hash-sizes", []( const std::string_view v ){ load_hash_sizes( v ); } );
+      args.add_size( "cache-limit", global_hash_args().cache_limit );
+      args.add_bool( "hash-stats", global_hash_args().hash_stats );
+      args.add_bool( "xattr", global_hash_args().xattr );
+      args.add_bool( "cache-neutral", global_hash_args().cache_neutral );
+      args.add_bool( "stream", global_hash_args().stream );
+      args.add_size( "chunk-size", global_hash_args().chunk_size );
+      args.add_size( "buffers", global_hash_args().buffers );
+      args.add_bool( "resident-first", global_hash_args().resident_first );
+      args.add_bool( "physical-order", global_hash_args().physical_order );
+      args.add_bool( "io-queues", global_hash_args().io_queues );
+      args.add_size( "ssd-depth", global_hash_args().ssd_depth );
+      args.add_size( "hdd-depth", global_hash_args().hdd_depth );
+   }
+
+   inline void print_hash_args_usage()
+   {
+      FILEZ_STDERR( "  Hashing options are..." );
+      FILEZ_STDERR( "    --hash ALGO       to select the hash algorithm, one of sha256 (default), blake3 or xxh3." );
+      FILEZ_STDERR( "    --hash-threads N  to hash large files with blake3 on up to N threads, default 1." );
+      FILEZ_STDERR( "    --samples K       to use K more smart hash samples per doubling of the file size." );
+      FILEZ_STDERR( "    --hash-sizes FILE to read additional smart hash chunk sizes per extension from FILE." );
+      FILEZ_STDERR( "    --cache-limit N   to limit the memory used by each hash cache to N MiB, default 256." );
+      FILEZ_STDERR( "    --hash-stats      to print hash cache statistics at the end." );
+      FILEZ_STDERR( "    --xattr           to store hashes in and re-use hashes from extended attributes." );
+      FILEZ_STDERR( "    --cache-neutral   to read with O_DIRECT or drop read pages from the page cache." );
+      FILEZ_STDERR( "    --stream          to read with a separate thread while hashing instead of mmap()." );
+      FILEZ_STDERR( "    --chunk-size N    to set the read size in bytes for --stream, default 1048576." );
+      FILEZ_STDERR( "    --buffers N       to set the number of read buffers for --stream, default 2." );
+      FILEZ_STDERR( "    --resident-first  to hash files found in the page cache before all others." );
+      FILEZ_STDERR( "    --physical-order  to hash files in the order of their physical location on disk." );
+      FILEZ_STDERR( "    --io-queues       to hash on multiple threads with one queue per device." );
+      FILEZ_STDERR( "    --ssd-depth N     to set the number of threads per non-rotating device, default 4." );
+      FILEZ_STDERR( "    --hdd-depth N     to set the number of threads per rotating disk, default 1." );
+   }
+
+}  // namespace filez
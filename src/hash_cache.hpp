@@ -0,0 +1,216 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "file_stat.hpp"
+#include "hash_args.hpp"
+#include "macros.hpp"
+
+namespace filez
+{
+   struct hash_cache_stats
+   {
+      std::atomic< std::size_t > hits = 0;
+      std::atomic< std::size_t > misses = 0;
+      std::atomic< std::size_t > bypassed = 0;  // Files with a single link are never looked up twice.
+      std::atomic< std::size_t > evictions = 0;
+   };
+
+   // This cache is for when we find the same inode via multiple paths.
+   // It is split into shards with separate locks to reduce contention, and the
+   // first thread to request the hash of a node calculates it while all other
+   // threads that request the same node in the meantime wait for that result.
+   // Only nodes with multiple hard links are cached, an entry is removed once
+   // all links were seen, and the CLOCK algorithm is used to keep the memory
+   // use below the limit set with --cache-limit.
+
+   class hash_cache
+   {
+   public:
+      hash_cache() noexcept = default;
+
+      hash_cache( hash_cache&& ) = delete;
+      hash_cache( const hash_cache& ) = delete;
+
+      void operator=( hash_cache&& ) = delete;
+      void operator=( const hash_cache& ) = delete;
+
+      template< typename F >
+      [[nodiscard]] std::string get( const file_stat& stat, F&& f )
+      {
+         if( stat.links() < 2 ) {
+            ++m_stats.bypassed;
+            return f();
+         }
+         const file_node node = stat.node();
+         shard& s = m_shards[ shard_index( node ) ];
+         std::unique_lock lock( s.mutex );
+
+         if( const auto iter = s.map.find( node ); iter != s.map.end() ) {
+            ++m_stats.hits;
+            const std::shared_future< std::string > future = iter->second.future;
+            iter->second.referenced = true;
+
+            if( --iter->second.remaining == 0 ) {
+               s.bytes -= iter->second.bytes;
+               s.map.erase( iter );
+               compact( s );
+            }
+            lock.unlock();
+            return future.get();
+         }
+         ++m_stats.misses;
+         std::promise< std::string > promise;
+         s.map.try_emplace( node, promise.get_future().share(), stat.links() - 1 );
+         s.clock.emplace_back( node );
+         lock.unlock();
+
+         try {
+            std::string hash = f();
+            promise.set_value( hash );
+            lock.lock();
+
+            if( const auto iter = s.map.find( node ); iter != s.map.end() ) {
+               iter->second.bytes = entry_bytes( hash );
+               s.bytes += iter->second.bytes;
+               evict( s );
+            }
+            return hash;
+         }
+         catch( ... ) {
+            // The waiting threads get the exception, later ones will try again.
+            promise.set_exception( std::current_exception() );
+            lock.lock();
+            s.map.erase( node );
+            throw;
+         }
+      }
+
+      // Forgets the hash of a node whose contents changed, for long-running processes that
+      // learn about changes; a calculation in progress still delivers its (stale) result to
+      // the threads already waiting for it.
+
+      void invalidate( const file_node node )
+      {
+         shard& s = m_shards[ shard_index( node ) ];
+         const std::lock_guard lock( s.mutex );
+
+         if( const auto iter = s.map.find( node ); iter != s.map.end() ) {
+            s.bytes -= iter->second.bytes;
+            s.map.erase( iter );
+            compact( s );
+         }
+      }
+
+      [[nodiscard]] const hash_cache_stats& stats() const noexcept
+      {
+         return m_stats;
+      }
+
+   private:
+      static constexpr std::size_t shards = 64;
+
+      struct entry
+      {
+         entry( std::shared_future< std::string >&& f, const std::size_t r ) noexcept
+            : future( std::move( f ) ),
+              remaining( r )
+         {}
+
+         std::shared_future< std::string > future;
+         std::size_t remaining;  // Number of links that have not been seen yet.
+         std::size_t bytes = 0;  // Remains 0 while the hash is being calculated.
+         bool referenced = false;
+      };
+
+      struct shard
+      {
+         std::mutex mutex;
+         std::size_t bytes = 0;
+         std::map< file_node, entry > map;
+         std::deque< file_node > clock;  // Can contain nodes that were already removed from the map.
+      };
+
+      std::array< shard, shards > m_shards;
+      hash_cache_stats m_stats;
+
+      [[nodiscard]] static std::size_t shard_index( const file_node node ) noexcept
+      {
+         return std::size_t( node.second ^ ( node.first * 31 ) ) % shards;
+      }
+
+      [[nodiscard]] static std::size_t entry_bytes( const std::string& hash ) noexcept
+      {
+         // Approximation including the map node and the shared state of the future.
+
+         return sizeof( std::pair< const file_node, entry > ) + 4 * sizeof( void* ) + 64 + hash.capacity() + sizeof( file_node );
+      }
+
+      static void compact( shard& s )
+      {
+         // Removes the nodes of entries that were erased when all their links were seen.
+
+         if( s.clock.size() > 2 * s.map.size() + 16 ) {
+            std::erase_if( s.clock, [ & ]( const file_node node ){ return !s.map.contains( node ); } );
+         }
+      }
+
+      void evict( shard& s )
+      {
+         const std::size_t limit = global_hash_args().cache_limit * 1024 * 1024 / shards;
+
+         // Entries whose hash is still being calculated have bytes == 0 and are skipped.
+
+         while( ( s.bytes > limit ) && ( !s.clock.empty() ) ) {
+            const file_node node = s.clock.front();
+            s.clock.pop_front();
+
+            const auto iter = s.map.find( node );
+
+            if( iter == s.map.end() ) {
+               continue;
+            }
+            if( iter->second.referenced || ( iter->second.bytes == 0 ) ) {
+               iter->second.referenced = false;
+               s.clock.emplace_back( node );
+               continue;
+            }
+            s.bytes -= iter->second.bytes;
+            s.map.erase( iter );
+            ++m_stats.evictions;
+         }
+      }
+   };
+
+   [[nodiscard]] inline hash_cache& global_total_hash_cache()
+   {
+      static hash_cache cache;
+      return cache;
+   }
+
+   [[nodiscard]] inline hash_cache& global_smart_hash_cache()
+   {
+      static hash_cache cache;
+      return cache;
+   }
+
+   inline void print_hash_cache_stats( const char* name, const hash_cache& cache )
+   {
+      const hash_cache_stats& stats = cache.stats();
+      const std::size_t lookups = stats.hits + stats.misses;
+
+      FILEZ_STDOUT( name << " hash cache: " << stats.hits << " hits of " << lookups << " lookups (" << ( lookups ? ( 100.0 * double( stats.hits ) / double( lookups ) ) : 0.0 ) << "%), " << stats.evictions << " evictions, " << stats.bypassed << " single link files not cached" );
+   }
+
+}  // namespace filez
@@ -2,63 +2,385 @@
 
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
 
 #include "data_hash.hpp"
 #include "file_mmap.hpp"
 #include "file_open.hpp"
+#include "file_read.hpp"
 #include "file_stat.hpp"
+#include "file_stream.hpp"
+#include "file_xattr.hpp"
+#include "hash_args.hpp"
+#include "hash_cache.hpp"
 #include "hash_size.hpp"
+#include "io_stats.hpp"
 #include "system.hpp"
 
 namespace filez
 {
-   // This cache is for when we find the same inode via multiple paths.
+   // The hash algorithm is chosen at runtime, the function object is called with a
+   // std::type_identity of the corresponding hash class in order to instantiate
+   // the hashing functions for that algorithm.
 
-   class hash_cache
+   template< typename F >
+   decltype( auto ) with_hash_algorithm( F&& f )
    {
-   public:
-      hash_cache() noexcept = default;
+      const std::string& algorithm = global_hash_args().algorithm;
 
-      [[nodiscard]] const std::string& get( const file_node node ) const noexcept
-      {
-         const auto iter = m_map.find( node );
-         return ( iter == m_map.end() ) ? m_empty : iter->second;
+      if( algorithm == "blake3" ) {
+         return f( std::type_identity< blake3 >() );
       }
+      if( algorithm == "xxh3" ) {
+         return f( std::type_identity< xxh3 >() );
+      }
+      return f( std::type_identity< sha256 >() );
+   }
 
-      [[nodiscard]] const std::string& put( const file_node node, std::string&& hash )
-      {
-         return m_map.try_emplace( node, std::move( hash ) ).first->second;
+   template< typename H >
+   [[nodiscard]] H make_hash()
+   {
+      if constexpr( std::is_constructible_v< H, unsigned > ) {
+         return H( unsigned( global_hash_args().hash_threads ) );
       }
+      else {
+         return H();
+      }
+   }
+
+   // Hashing is generic over where the bytes come from, a file_mmap, a file_read or a file_stream;
+   // read_range() calls f( data, size ) for consecutive pieces of the requested range.
+
+   template< typename F >
+   void read_range( const file_mmap& mmap, const std::size_t offset, const std::size_t size, F&& f )
+   {
+      f( mmap.data() + offset, size );
+   }
 
-   private:
-      const std::string m_empty;
+   template< typename F >
+   void read_range( file_read& read, const std::size_t offset, const std::size_t size, F&& f )
+   {
+      read.read( offset, size, f );
+   }
 
-      std::map< file_node, std::string > m_map;
-   };
+   template< typename F >
+   void read_range( file_stream& stream, const std::size_t offset, const std::size_t size, F&& f )
+   {
+      stream.read( offset, size, f );
+   }
+
+   template< typename H, typename S >
+   void hash_range( basic_data_hash< H >& hash, S& source, const std::size_t offset, const std::size_t size )
+   {
+      read_range( source, offset, size, [ & ]( const char* data, const std::size_t part ){ hash.update( data, part ); } );
+   }
+
+   // Prefetching lets the reads for all samples of a smart hash proceed concurrently; there is
+   // nothing to do for a file_read since it must not pull anything into the page cache.
+
+   inline void prefetch_range( const file_mmap& mmap, const std::size_t offset, const std::size_t size ) noexcept
+   {
+      mmap.will_need( offset, size );
+   }
+
+   inline void prefetch_range( file_read&, const std::size_t, const std::size_t ) noexcept
+   {}
+
+   inline void prefetch_range( file_stream&, const std::size_t, const std::size_t ) noexcept
+   {}
+
+   // The number of samples for the 'S' scope grows logarithmically with the file size, by
+   // the given rate per doubling, but is at most one per three chunk sizes of the file, so
+   // that the samples cover about a third of the file or less; the exception are files of
+   // three to six chunk sizes, where the minimum of two samples covers up to two thirds.
+   // The samples are evenly spread, page aligned, and the last one extends to the end.
+
+   [[nodiscard]] inline std::vector< std::pair< std::size_t, std::size_t > > smart_hash_samples( const std::size_t total, const std::size_t size, const std::size_t rate )
+   {
+      const std::size_t ratio = total / ( 3 * size );
+      const std::size_t count = std::min( 2 + rate * ( std::bit_width( ratio ) - 1 ), std::max< std::size_t >( 2, ratio ) );
+      const std::size_t step = ( total - size ) / ( count - 1 );
+
+      std::vector< std::pair< std::size_t, std::size_t > > result;
+
+      for( std::size_t i = 0; i + 1 < count; ++i ) {
+         result.emplace_back( rounded_down_to_pagesize( i * step ), size );
+      }
+      const std::size_t offset = rounded_down_to_pagesize( total - size );
+      result.emplace_back( offset, total - offset );
+      return result;
+   }
 
    // The first character of the result indicates the hash scope:
    // 'E' stands for "empty", i.e. the hashed file is empty.
    // 'T' stands for "total", i.e. all bytes of the file were hashed,
    // 'P' stands for "partial", i.e. that some bytes were skipped.
+   // 'S' stands for "sampled", i.e. like 'P' but with the samples from --samples.
    // 'C' stands for "contents", i.e. the file contents are the hash.
+   // For 'T' and 'P' the hash_traits tag of the algorithm follows.
+
+   template< typename H, typename S >
+   [[nodiscard]] std::string basic_hash_total( S& source, const std::size_t total )
+   {
+      basic_data_hash< H > hash( make_hash< H >() );
+      hash_range( hash, source, 0, total );
+      return hash.result( 'T' );
+   }
+
+   // The ranges of the file that are hashed for the smart hash together with the scope.
+   // The ranges are sorted and disjoint, which basic_hash_both() below relies on.
+
+   [[nodiscard]] inline std::pair< char, std::vector< std::pair< std::size_t, std::size_t > > > smart_hash_ranges( const std::size_t total, const std::size_t size )
+   {
+      // Small file or file without configured partial hash size: hash everything.
+
+      if( total <= 3 * size ) {
+         return { 'T', { { 0, total } } };
+      }
+      // Large file with configured partial hash size and --samples: hash the samples.
+
+      if( const std::size_t rate = global_hash_args().samples ) {
+         return { 'S', smart_hash_samples( total, size, rate ) };
+      }
+      // Large file with configured partial hash size: hash only two or three chunks:
+      // Always the first and last chunk, for very large files also the "middle" one.
+
+      std::vector< std::pair< std::size_t, std::size_t > > result;
+      result.emplace_back( 0, size );
+
+      if( total > 1024 * size ) {
+         result.emplace_back( rounded_down_to_pagesize( total / 2 ), size );
+      }
+      const std::size_t offset = rounded_down_to_pagesize( total - size );
+      result.emplace_back( offset, total - offset );
+      return { 'P', std::move( result ) };
+   }
+
+   template< typename H, typename S >
+   [[nodiscard]] std::string basic_hash_smart( S& source, const std::size_t total, const std::size_t size )
+   {
+      basic_data_hash< H > hash( make_hash< H >() );
+      const auto [ scope, ranges ] = smart_hash_ranges( total, size );
+
+      if( scope == 'S' ) {
+         for( const auto& [ offset, length ] : ranges ) {
+            prefetch_range( source, offset, length );
+         }
+      }
+      for( const auto& [ offset, length ] : ranges ) {
+         hash_range( hash, source, offset, length );
+      }
+      return hash.result( scope );
+   }
+
+   // Calculates the smart and the total hash, in this order, in a single pass over the file:
+   // All bytes are fed to the total hash, and those within the smart hash ranges are also fed
+   // to the smart hash, which is therefore the same as when calculated by basic_hash_smart().
+
+   template< typename H, typename S >
+   [[nodiscard]] std::pair< std::string, std::string > basic_hash_both( S& source, const std::size_t total, const std::size_t size )
+   {
+      basic_data_hash< H > whole( make_hash< H >() );
+      const auto [ scope, ranges ] = smart_hash_ranges( total, size );
+
+      if( scope == 'T' ) {
+         hash_range( whole, source, 0, total );
+         std::string hash = whole.result( 'T' );
+         return { hash, hash };
+      }
+      basic_data_hash< H > smart( make_hash< H >() );
+
+      std::size_t pos = 0;
+      auto next = ranges.begin();
+
+      read_range( source, 0, total, [ & ]( const char* data, const std::size_t part ){
+         const std::size_t end = pos + part;
+         whole.update( data, part );
+
+         for( auto iter = next; ( iter != ranges.end() ) && ( iter->first < end ); ++iter ) {
+            const std::size_t b = std::max( pos, iter->first );
+            const std::size_t e = std::min( end, iter->first + iter->second );
+
+            if( b < e ) {
+               smart.update( data + ( b - pos ), e - b );
+            }
+         }
+         while( ( next != ranges.end() ) && ( next->first + next->second <= end ) ) {
+            ++next;
+         }
+         pos = end;
+      } );
+      return { smart.result( scope ), whole.result( 'T' ) };
+   }
+
+   template< typename S >
+   [[nodiscard]] std::string hash_total_impl( S& source, const std::size_t total )
+   {
+      return with_hash_algorithm( [ & ]< typename H >( std::type_identity< H > ){ return basic_hash_total< H >( source, total ); } );
+   }
+
+   template< typename S >
+   [[nodiscard]] std::string hash_smart_impl( S& source, const std::size_t total, const std::size_t size )
+   {
+      return with_hash_algorithm( [ & ]< typename H >( std::type_identity< H > ){ return basic_hash_smart< H >( source, total, size ); } );
+   }
+
+   template< typename S >
+   [[nodiscard]] std::pair< std::string, std::string > hash_both_impl( S& source, const std::size_t total, const std::size_t size )
+   {
+      return with_hash_algorithm( [ & ]< typename H >( std::type_identity< H > ){ return basic_hash_both< H >( source, total, size ); } );
+   }
+
+   // The chunk size for the smart hash depends on the first bytes of the file and,
+   // when the format is not recognised from these, on the file name extension.
+
+   [[nodiscard]] inline std::size_t smart_hash_size( const std::filesystem::path& path, const file_open& open, const std::size_t total )
+   {
+      char head[ hash_size_head ];
+      const ::ssize_t r = ::pread( open.get(), head, std::min( sizeof( head ), total ), 0 );
+
+      if( r < 0 ) {
+         FILEZ_ERRNO( "unable to pread() file " << path );
+      }
+      return hash_size( path, total, std::string_view( head, std::size_t( r ) ) );
+   }
+
+   // Whether a hash can be used as total hash, i.e. whether it was calculated over all bytes.
+
+   [[nodiscard]] inline bool is_partial_hash( const std::string& hash ) noexcept
+   {
+      return ( !hash.empty() ) && ( ( hash[ 0 ] == 'P' ) || ( hash[ 0 ] == 'S' ) );
+   }
+
+   // With --xattr the hashes are stored in extended attributes together with a stamp of
+   // everything they depend on, the file size and modification time, and for the smart
+   // hash the number of samples and the chunk size rule for the extension, and are re-used
+   // by later runs while the stamp still matches. The chunk size recognised from the first
+   // bytes of the file is not part of the stamp since it only depends on the contents, so
+   // that a hit doesn't read any data; it is stored between the stamp and the smart hash.
+   // Since hard links share their extended attributes this also works across links.
+
+   [[nodiscard]] inline std::string hash_stamp( const file_stat& stat )
+   {
+      const file_time mtime = stat.mtime();
+      return std::to_string( stat.size() ) + ' ' + std::to_string( std::uint64_t( mtime / 1000000000 ) ) + '.' + std::to_string( std::uint64_t( mtime % 1000000000 ) );
+   }
+
+   [[nodiscard]] inline bool is_current_hash( const std::string_view hash, const std::string_view scopes )
+   {
+      return with_hash_algorithm( [ & ]< typename H >( std::type_identity< H > ){
+         constexpr char tag = hash_traits< H >::tag;
+         constexpr std::size_t prefix = ( tag == 0 ) ? 1 : 2;
+
+         if( ( hash.size() != prefix + 2 * hash_traits< H >::size ) || ( scopes.find( hash[ 0 ] ) == std::string_view::npos ) ) {
+            return false;
+         }
+         if( ( tag != 0 ) && ( hash[ 1 ] != tag ) ) {
+            return false;
+         }
+         return hash.find_first_not_of( "0123456789abcdef", prefix ) == std::string_view::npos;
+      } );
+   }
+
+   // Returns the hash stored for the stamp, if any; the hash is the last word of the value.
+
+   [[nodiscard]] inline std::optional< std::string > get_xattr_hash( const char* name, const file_open& open, const std::string& stamp, const std::string_view scopes )
+   {
+      if( !global_hash_args().xattr ) {
+         return std::nullopt;
+      }
+      if( const auto value = get_xattr( open.get(), name ) ) {
+         const std::string_view view( *value );
+
+         if( ( view.size() > stamp.size() ) && view.starts_with( stamp ) && ( view[ stamp.size() ] == ' ' ) ) {
+            if( const std::string_view hash = view.substr( view.rfind( ' ' ) + 1 ); is_current_hash( hash, scopes ) ) {
+               return std::string( hash );
+            }
+         }
+      }
+      return std::nullopt;
+   }
+
+   inline void set_xattr_hash( const char* name, const file_open& open, const std::string& stamp, const std::string& hash )
+   {
+      if( global_hash_args().xattr ) {
+         (void)set_xattr( open.get(), name, stamp + ' ' + hash );
+      }
+   }
+
+   template< typename F >
+   [[nodiscard]] std::string hash_with_xattr( const char* name, const file_open& open, const std::string& stamp, const std::string_view scopes, F&& f )
+   {
+      if( auto hash = get_xattr_hash( name, open, stamp, scopes ) ) {
+         return std::move( *hash );
+      }
+      std::string hash = f();
+      set_xattr_hash( name, open, stamp, hash );
+      return hash;
+   }
+
+   // Calls f with the file_read, file_stream or file_mmap chosen by the arguments.
+
+   template< typename F >
+   [[nodiscard]] auto with_hash_source( const std::filesystem::path& path, const file_open& open, const file_stat& stat, F&& f )
+   {
+      if( global_hash_args().cache_neutral ) {
+         file_read read( path, stat );
+         return f( read );
+      }
+      if( global_hash_args().stream ) {
+         file_stream stream( path, stat, global_hash_args().chunk_size, global_hash_args().buffers );
+         return f( stream );
+      }
+      file_mmap mmap( path, open, stat );
+      return f( mmap );
+   }
 
    [[nodiscard]] inline std::string hash_file_total( const std::filesystem::path& path, const file_open& open, const file_stat& stat )
    {
       if( stat.size() == 0 ) {
          return "E";
       }
-      static hash_cache cache;
+      return global_total_hash_cache().get( stat, [ & ](){
+         return hash_with_xattr( "user.filez.total", open, hash_stamp( stat ), "T", [ & ](){
+            return with_hash_source( path, open, stat, [ & ]( auto& source ){ return hash_total_impl( source, source.size() ); } );
+         } );
+      } );
+   }
 
-      if( const std::string& hash = cache.get( stat.node() ); !hash.empty() ) {
-         return hash;
+   [[nodiscard]] inline std::string smart_hash_stamp( const std::filesystem::path& path, const file_stat& stat )
+   {
+      const std::size_t rate = global_hash_args().samples;
+      return hash_stamp( stat ) + ' ' + hash_size_rule( path ) + ( rate ? ( " S" + std::to_string( rate ) ) : "" );
+   }
+
+   [[nodiscard]] inline std::string_view smart_hash_scopes() noexcept
+   {
+      return global_hash_args().samples ? "TS" : "TP";
+   }
+
+   // Everything the smart hashes depend on besides the algorithm and the files, the number of
+   // samples and the --hash-sizes overrides, to check smart hashes stored by another run.
+
+   [[nodiscard]] inline std::string smart_hash_config()
+   {
+      std::string result = 'S' + std::to_string( global_hash_args().samples );
+
+      for( const auto& [ extension, size ] : hash_size_overrides() ) {
+         result += ' ' + extension + ' ' + std::to_string( size );
       }
-      file_mmap mmap( path, open, stat );
-      data_hash hash;
-      hash.update( mmap );
-      return cache.put( stat.node(), hash.result( 'T' ) );
+      return result;
    }
 
    [[nodiscard]] inline std::string hash_file_smart( const std::filesystem::path& path, const file_open& open, const file_stat& stat )
@@ -66,35 +388,57 @@ namespace filez
       if( stat.size() == 0 ) {
          return "E";
       }
-      static hash_cache cache;
+      return global_smart_hash_cache().get( stat, [ & ](){
+         const std::string stamp = smart_hash_stamp( path, stat );
 
-      if( const std::string& hash = cache.get( stat.node() ); !hash.empty() ) {
+         if( auto hash = get_xattr_hash( "user.filez.smart", open, stamp, smart_hash_scopes() ) ) {
+            return std::move( *hash );
+         }
+         const std::size_t size = smart_hash_size( path, open, stat.size() );
+         std::string hash = with_hash_source( path, open, stat, [ & ]( auto& source ){ return hash_smart_impl( source, source.size(), size ); } );
+         set_xattr_hash( "user.filez.smart", open, stamp + ' ' + std::to_string( size ), hash );
          return hash;
-      }
-      file_mmap mmap( path, open, stat );
-      data_hash hash;
-
-      const std::size_t size = hash_size( path, mmap.size() );
+      } );
+   }
 
-      // Small file or file without configured partial hash size: hash everything.
+   // Returns the smart and the total hash; when the total hash has to be calculated the
+   // smart hash is obtained in the same pass, otherwise it is calculated as usual. Both
+   // caches and both extended attributes are used and updated like for separate calls.
 
-      if( mmap.size() <= 3 * size ) {
-         hash.update( mmap );
-         return cache.put( stat.node(), hash.result( 'T' ) );
+   [[nodiscard]] inline std::pair< std::string, std::string > hash_file_both( const std::filesystem::path& path, const file_open& open, const file_stat& stat )
+   {
+      if( stat.size() == 0 ) {
+         return { "E", "E" };
       }
-      // Large file with configured partial hash size: hash only two or three chunks:
-      // Always the first and last chunk, for very large files also the "middle" one.
+      std::size_t size = 0;  // Only read from the file when a hash has to be calculated.
 
-      hash.update( mmap.data(), size );
+      const auto chunk = [ & ](){
+         if( size == 0 ) {
+            size = smart_hash_size( path, open, stat.size() );
+         }
+         return size;
+      };
+      std::string smart;
+      std::string total = global_total_hash_cache().get( stat, [ & ](){
+         return hash_with_xattr( "user.filez.total", open, hash_stamp( stat ), "T", [ & ](){
+            auto both = with_hash_source( path, open, stat, [ & ]( auto& source ){ return hash_both_impl( source, source.size(), chunk() ); } );
+            smart = std::move( both.first );
+            return std::move( both.second );
+         } );
+      } );
+      smart = global_smart_hash_cache().get( stat, [ & ](){
+         const std::string stamp = smart_hash_stamp( path, stat );
 
-      if( mmap.size() > 1024 * size ) {
-         const std::size_t offset = rounded_down_to_pagesize( mmap.size() / 2 );
-         hash.update( mmap.data() + offset, size );
-      } {
-         const std::size_t offset = rounded_down_to_pagesize( mmap.size() - size );
-         hash.update( mmap.data() + offset, mmap.size() - offset );
-      }
-      return cache.put( stat.node(), hash.result( 'P' ) );
+         if( auto hash = get_xattr_hash( "user.filez.smart", open, stamp, smart_hash_scopes() ) ) {
+            return std::move( *hash );
+         }
+         if( smart.empty() ) {
+            smart = with_hash_source( path, open, stat, [ & ]( auto& source ){ return hash_smart_impl( source, source.size(), chunk() ); } );
+         }
+         set_xattr_hash( "user.filez.smart", open, stamp + ' ' + std::to_string( chunk() ), smart );
+         return smart;
+      } );
+      return { std::move( smart ), std::move( total ) };
    }
 
    [[nodiscard]] inline std::string hash_file_total( const std::filesystem::path& path )
@@ -111,4 +455,15 @@ namespace filez
       return hash_file_smart( path, open, stat );
    }
 
+   inline void print_hash_statistics()
+   {
+      if( global_hash_args().cache_neutral ) {
+         print_io_stats();
+      }
+      if( global_hash_args().hash_stats ) {
+         print_hash_cache_stats( "Smart", global_smart_hash_cache() );
+         print_hash_cache_stats( "Total", global_total_hash_cache() );
+      }
+   }
+
 } // filez
@@ -0,0 +1,170 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <memory>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+#include "device_queues.hpp"
+#include "file_extent.hpp"
+#include "file_info.hpp"
+#include "hash_args.hpp"
+#include "page_cache.hpp"
+#include "system.hpp"
+
+namespace filez
+{
+   // A file counts as resident when all pages of (a prefix of) the file are in the page cache.
+
+   [[nodiscard]] inline bool is_resident( const int fd, const std::size_t size, std::vector< unsigned char >& pages )
+   {
+      static constexpr std::size_t probe_size = 16 * 1024 * 1024;
+
+      const std::size_t probe = std::min( size, probe_size );
+      return resident_pages( fd, 0, probe, pages ) == pages.size();
+   }
+
+   struct hash_order_entry
+   {
+      file_info* info;
+
+      bool cold = true;
+      ::dev_t device = 0;
+      bool inode = true;  // The position is the inode number because the physical position is not known.
+      std::uint64_t position = 0;
+
+      [[nodiscard]] auto key() const noexcept
+      {
+         return std::tie( cold, device, inode, position );
+      }
+   };
+
+   [[nodiscard]] inline hash_order_entry make_hash_order_entry( file_info& fi, const bool residency, const bool physical, std::vector< unsigned char >& pages )
+   {
+      hash_order_entry result{ &fi };
+
+      result.device = fi.stat().device();
+      result.position = fi.stat().inode();
+
+      if( ( !residency ) && ( !physical ) ) {
+         return result;
+      }
+      const int fd = ::open( fi.path().c_str(), O_RDONLY );
+
+      if( fd < 0 ) {
+         return result;  // Let the actual hashing report the error.
+      }
+      if( residency ) {
+         result.cold = !is_resident( fd, fi.stat().size(), pages );
+      }
+      if( physical ) {
+         if( const auto offset = physical_offset( fd ) ) {
+            result.inode = false;
+            result.position = *offset;
+         }
+      }
+      ::close( fd );
+      return result;
+   }
+
+   // Returns the files in the order in which they should be hashed. With residency those
+   // that are currently in the page cache come first, before they can be evicted by reading
+   // others. The remaining ones are grouped by device and sorted by physical position when
+   // physical is set and the filesystem supports it, or otherwise by inode number, which is
+   // a reasonable approximation of their on-disk order for most filesystems.
+
+   [[nodiscard]] inline std::vector< file_info* > hash_order( const std::vector< file_info* >& files, const bool residency, const bool physical )
+   {
+      std::vector< hash_order_entry > entries;
+      std::vector< unsigned char > pages;
+
+      entries.reserve( files.size() );
+
+      for( file_info* fi : files ) {
+         entries.emplace_back( make_hash_order_entry( *fi, residency, physical, pages ) );
+      }
+      std::stable_sort( entries.begin(), entries.end(), []( const hash_order_entry& l, const hash_order_entry& r ){ return l.key() < r.key(); } );
+
+      std::vector< file_info* > result;
+      result.reserve( entries.size() );
+
+      for( const auto& entry : entries ) {
+         result.emplace_back( entry.info );
+      }
+      return result;
+   }
+
+   // Calls f for every file in the order given by hash_order() when one of the corresponding options is enabled,
+   // using one queue per device when so configured; f is expected to compute and thereby cache the required
+   // hash(es) in the file_info before the caller iterates over the files in their original order, which keeps
+   // the output independent of the order and (potential) concurrency of the hashing.
+
+   template< typename F >
+   void schedule_hashing( const std::vector< file_info* >& files, F&& f )
+   {
+      const hash_args& args = global_hash_args();
+
+      if( ( !args.resident_first ) && ( !args.physical_order ) && ( !args.io_queues ) ) {
+         return;
+      }
+      const auto order = ( args.resident_first || args.physical_order ) ? hash_order( files, args.resident_first, args.physical_order ) : files;
+
+      if( args.io_queues ) {
+         run_device_queues( order, f );
+      }
+      else {
+         for( file_info* fi : order ) {
+            f( *fi );
+         }
+      }
+   }
+
+   // Schedules the hashing for all files in all buckets of the map that are accepted by
+   // the predicate p, the default being all buckets with more than one file, which are
+   // those for which the callers of this function need the hashes for their work.
+
+   template< typename M, typename P, typename F >
+   void schedule_bucket_hashing( const M& map, P&& p, F&& f )
+   {
+      std::vector< file_info* > files;
+
+      for( const auto& kv : map ) {
+         if( p( kv.second ) ) {
+            for( const auto& fi : kv.second ) {
+               files.emplace_back( fi.get() );
+            }
+         }
+      }
+      schedule_hashing( files, f );
+   }
+
+   template< typename M, typename F >
+   void schedule_bucket_hashing( const M& map, F&& f )
+   {
+      schedule_bucket_hashing( map, []( const auto& bucket ){ return bucket.size() > 1; }, f );
+   }
+
+   // The same for a vector of groups of files instead of a map with buckets.
+
+   template< typename G, typename P, typename F >
+   void schedule_group_hashing( const std::vector< G >& groups, P&& p, F&& f )
+   {
+      std::vector< file_info* > files;
+
+      for( const auto& group : groups ) {
+         if( p( group ) ) {
+            for( const auto& fi : group ) {
+               files.emplace_back( fi.get() );
+            }
+         }
+      }
+      schedule_hashing( files, f );
+   }
+
+}  // namespace filez
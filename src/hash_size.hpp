@@ -3,77 +3,280 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cstddef>
-#include <cstring>
 #include <filesystem>
-#include <map>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include "macros.hpp"
 #include "system.hpp"
 
 namespace filez
 {
-   [[nodiscard]] auto hash_size_data()
-   {
-      static const std::size_t audio_hash_size = rounded_up_to_pagesize( 4096 );
-      static const std::size_t image_hash_size = rounded_up_to_pagesize( 4096 );
-      static const std::size_t video_hash_size = rounded_up_to_pagesize( 16384 );
-      static const std::size_t archive_hash_size = rounded_up_to_pagesize( 65536 );
-
-      // NOTE: For obvious reasons (potentially) uncompressed file
-      // formats like BMP and TAR should NEVER use a partial hash!
-
-      static const std::map< std::string, std::size_t, decltype( []( const std::string& l, const std::string& r ){ return ::strcasecmp( l.c_str(), r.c_str() ) < 0; } ) > map = {
-         { ".avi", video_hash_size },
-         { ".mp4", video_hash_size },
-         { ".m4v", video_hash_size },
-         { ".mov", video_hash_size },
-         { ".mpg", video_hash_size },
-         { ".mpeg", video_hash_size },
-         { ".mkv", video_hash_size },
-         { ".flv", video_hash_size },
-         { ".vob", video_hash_size },
-         { ".wmv", video_hash_size },
-         { ".swf", video_hash_size },
-         { ".webm", video_hash_size },
-
-         { ".aac", audio_hash_size },
-         { ".alac", audio_hash_size },
-         { ".flac", audio_hash_size },
-         { ".m4a", audio_hash_size },
-         { ".mp3", audio_hash_size },
-         { ".ogg", audio_hash_size },
-         { ".wma", audio_hash_size },
-
-         { ".cr2", image_hash_size },
-         { ".dng", image_hash_size },
-         { ".jpg", image_hash_size },
-         { ".jpeg", image_hash_size },
-         { ".nef", image_hash_size },
-         { ".png", image_hash_size },
-
-         { ".7z", archive_hash_size },
-         { ".arj", archive_hash_size },
-         { ".bz2", archive_hash_size },
-         { ".gz", archive_hash_size },
-         { ".lha", archive_hash_size },
-         { ".lhx", archive_hash_size },
-         { ".lzh", archive_hash_size },
-         { ".rar", archive_hash_size },
-         { ".tgz", archive_hash_size },
-         { ".xpk", archive_hash_size },
-         { ".xz", archive_hash_size },
-         { ".z", archive_hash_size },
-         { ".zip", archive_hash_size }
+   constexpr std::size_t audio_hash_bytes = 4096;
+   constexpr std::size_t image_hash_bytes = 4096;
+   constexpr std::size_t video_hash_bytes = 16384;
+   constexpr std::size_t archive_hash_bytes = 65536;
+
+   [[nodiscard]] inline std::size_t audio_hash_size()
+   {
+      static const std::size_t size = rounded_up_to_pagesize( audio_hash_bytes );
+      return size;
+   }
+
+   [[nodiscard]] inline std::size_t image_hash_size()
+   {
+      static const std::size_t size = rounded_up_to_pagesize( image_hash_bytes );
+      return size;
+   }
+
+   [[nodiscard]] inline std::size_t video_hash_size()
+   {
+      static const std::size_t size = rounded_up_to_pagesize( video_hash_bytes );
+      return size;
+   }
+
+   [[nodiscard]] inline std::size_t archive_hash_size()
+   {
+      static const std::size_t size = rounded_up_to_pagesize( archive_hash_bytes );
+      return size;
+   }
+
+   [[nodiscard]] constexpr char hash_size_fold( const char c ) noexcept
+   {
+      return ( ( c >= 'A' ) && ( c <= 'Z' ) ) ? char( c - 'A' + 'a' ) : c;
+   }
+
+   // Case-insensitive ordering of file name extensions without allocating memory.
+
+   [[nodiscard]] constexpr bool hash_size_less( const std::string_view l, const std::string_view r ) noexcept
+   {
+      return std::lexicographical_compare( l.begin(), l.end(), r.begin(), r.end(), []( const char a, const char b ){ return hash_size_fold( a ) < hash_size_fold( b ); } );
+   }
+
+   struct hash_size_entry
+   {
+      std::string_view extension;
+      std::size_t size;
+   };
+
+   // NOTE: For obvious reasons (potentially) uncompressed file
+   // formats like BMP and TAR should NEVER use a partial hash!
+
+   constexpr auto hash_size_table = []() {
+      std::array< hash_size_entry, 38 > table = { {
+         { ".avi", video_hash_bytes },
+         { ".mp4", video_hash_bytes },
+         { ".m4v", video_hash_bytes },
+         { ".mov", video_hash_bytes },
+         { ".mpg", video_hash_bytes },
+         { ".mpeg", video_hash_bytes },
+         { ".mkv", video_hash_bytes },
+         { ".flv", video_hash_bytes },
+         { ".vob", video_hash_bytes },
+         { ".wmv", video_hash_bytes },
+         { ".swf", video_hash_bytes },
+         { ".webm", video_hash_bytes },
+
+         { ".aac", audio_hash_bytes },
+         { ".alac", audio_hash_bytes },
+         { ".flac", audio_hash_bytes },
+         { ".m4a", audio_hash_bytes },
+         { ".mp3", audio_hash_bytes },
+         { ".ogg", audio_hash_bytes },
+         { ".wma", audio_hash_bytes },
+
+         { ".cr2", image_hash_bytes },
+         { ".dng", image_hash_bytes },
+         { ".jpg", image_hash_bytes },
+         { ".jpeg", image_hash_bytes },
+         { ".nef", image_hash_bytes },
+         { ".png", image_hash_bytes },
+
+         { ".7z", archive_hash_bytes },
+         { ".arj", archive_hash_bytes },
+         { ".bz2", archive_hash_bytes },
+         { ".gz", archive_hash_bytes },
+         { ".lha", archive_hash_bytes },
+         { ".lhx", archive_hash_bytes },
+         { ".lzh", archive_hash_bytes },
+         { ".rar", archive_hash_bytes },
+         { ".tgz", archive_hash_bytes },
+         { ".xpk", archive_hash_bytes },
+         { ".xz", archive_hash_bytes },
+         { ".z", archive_hash_bytes },
+         { ".zip", archive_hash_bytes }
+      } };
+      std::sort( table.begin(), table.end(), []( const hash_size_entry& l, const hash_size_entry& r ){ return hash_size_less( l.extension, r.extension ); } );
+      return table;
+   }();
+
+   static_assert( std::none_of( hash_size_table.begin(), hash_size_table.end(), []( const hash_size_entry& e ){ return e.extension.empty(); } ) );
+   static_assert( std::adjacent_find( hash_size_table.begin(), hash_size_table.end(), []( const hash_size_entry& l, const hash_size_entry& r ){ return !hash_size_less( l.extension, r.extension ); } ) == hash_size_table.end() );
+
+   // Entries loaded with --hash-sizes take precedence over the built-in table, a size of 0 means
+   // that files with this extension are always hashed in full. Sorted with hash_size_less().
+
+   [[nodiscard]] inline std::vector< std::pair< std::string, std::size_t > >& hash_size_overrides() noexcept
+   {
+      static std::vector< std::pair< std::string, std::size_t > > overrides;
+      return overrides;
+   }
+
+   // Reads lines of the form "EXTENSION BYTES", e.g. ".mp4 16384", empty lines and lines starting with '#' are ignored.
+
+   inline void load_hash_sizes( const std::filesystem::path& path )
+   {
+      std::ifstream stream( path );
+
+      if( !stream ) {
+         FILEZ_ERROR( "unable to open hash sizes file " << path );
+      }
+      auto& overrides = hash_size_overrides();
+      std::string line;
+
+      while( std::getline( stream, line ) ) {
+         std::istringstream iss( line );
+         std::string extension;
+         std::size_t size;
+
+         if( ( !( iss >> extension ) ) || extension.starts_with( '#' ) ) {
+            continue;
+         }
+         if( !( iss >> size ) ) {
+            FILEZ_ERROR( "invalid line '" << line << "' in hash sizes file " << path );
+         }
+         if( !extension.starts_with( '.' ) ) {
+            extension.insert( extension.begin(), '.' );
+         }
+         const auto iter = std::lower_bound( overrides.begin(), overrides.end(), extension, []( const auto& l, const std::string& r ){ return hash_size_less( l.first, r ); } );
+
+         if( ( iter != overrides.end() ) && ( !hash_size_less( extension, iter->first ) ) ) {
+            iter->second = size ? rounded_up_to_pagesize( size ) : 0;
+         }
+         else {
+            overrides.emplace( iter, std::move( extension ), size ? rounded_up_to_pagesize( size ) : 0 );
+         }
+      }
+   }
+
+   // Same as path.extension() but without allocating a new string.
+
+   [[nodiscard]] inline std::string_view hash_size_extension( const std::filesystem::path& path ) noexcept
+   {
+      const std::string_view native = path.native();
+      const std::string_view name = native.substr( native.rfind( '/' ) + 1 );
+      const std::size_t dot = name.rfind( '.' );
+
+      if( ( dot == std::string_view::npos ) || ( dot == 0 ) || ( name == ".." ) ) {
+         return std::string_view();
+      }
+      return name.substr( dot );
+   }
+
+   [[nodiscard]] inline const std::pair< std::string, std::size_t >* hash_size_override( const std::string_view extension )
+   {
+      const auto& overrides = hash_size_overrides();
+      const auto iter = std::lower_bound( overrides.begin(), overrides.end(), extension, []( const auto& l, const std::string_view r ){ return hash_size_less( l.first, r ); } );
+      return ( ( iter != overrides.end() ) && ( !hash_size_less( extension, iter->first ) ) ) ? &*iter : nullptr;
+   }
+
+   // Returns the chunk size configured for the extension, 0 when none is configured,
+   // and the given size when the extension is configured for a full hash.
+
+   [[nodiscard]] inline std::size_t hash_size_lookup( const std::string_view extension, const std::size_t size )
+   {
+      if( const auto* entry = hash_size_override( extension ) ) {
+         return entry->second ? entry->second : size;
+      }
+      const auto iter = std::lower_bound( hash_size_table.begin(), hash_size_table.end(), extension, []( const hash_size_entry& l, const std::string_view r ){ return hash_size_less( l.extension, r ); } );
+
+      if( ( iter != hash_size_table.end() ) && ( !hash_size_less( extension, iter->extension ) ) ) {
+         return rounded_up_to_pagesize( iter->size );
+      }
+      return 0;
+   }
+
+   [[nodiscard]] inline std::size_t hash_size( const std::filesystem::path& path, const std::size_t size )
+   {
+      const std::size_t result = hash_size_lookup( hash_size_extension( path ), size );
+      return result ? result : size;
+   }
+
+   // Describes the chunk size rule for the extension of the path, everything that hash_size()
+   // depends on except for the file size and contents, for the stamps of stored smart hashes.
+
+   [[nodiscard]] inline std::string hash_size_rule( const std::filesystem::path& path )
+   {
+      const std::string_view extension = hash_size_extension( path );
+
+      if( const auto* entry = hash_size_override( extension ) ) {
+         return 'o' + std::to_string( entry->second );
+      }
+      return 'e' + std::to_string( hash_size_lookup( extension, 0 ) );
+   }
+
+   // The number of bytes at the beginning of a file that hash_size_sniff() looks at.
+
+   constexpr std::size_t hash_size_head = 64;
+
+   // Recognises common file formats by their magic numbers; returns 0 for unknown formats,
+   // and the size of the file when it is known to be (potentially) uncompressed, e.g. WAV
+   // files or ZIP archives whose first entry is stored rather than compressed.
+
+   [[nodiscard]] inline std::size_t hash_size_sniff( const std::string_view head, const std::size_t size )
+   {
+      const auto magic = [ & ]( const std::size_t offset, const std::string_view bytes ){
+         return head.substr( std::min( offset, head.size() ) ).starts_with( bytes );
       };
-      return map;
+      if( magic( 0, "\xFF\xD8\xFF" ) || magic( 0, "\x89PNG\r\n\x1A\n" ) || magic( 0, "GIF8" ) ) {
+         return image_hash_size();
+      }
+      if( magic( 4, "ftyp" ) || magic( 4, "moov" ) || magic( 4, "mdat" ) || magic( 4, "wide" ) ) {
+         return video_hash_size();  // MP4, MOV, M4V, but also M4A and HEIC, all compressed.
+      }
+      if( magic( 0, "\x1A\x45\xDF\xA3" ) || magic( 0, std::string_view( "\x00\x00\x01\xBA", 4 ) ) || magic( 0, "\x30\x26\xB2\x75\x8E\x66\xCF\x11" ) || magic( 0, "FLV\x01" ) ) {
+         return video_hash_size();  // MKV and WEBM, MPEG program stream, ASF (WMV and WMA), FLV.
+      }
+      if( magic( 0, "RIFF" ) && magic( 8, "AVI " ) ) {
+         return video_hash_size();
+      }
+      if( magic( 0, "RIFF" ) && magic( 8, "WAVE" ) ) {
+         return size;
+      }
+      if( magic( 0, "fLaC" ) || magic( 0, "OggS" ) || magic( 0, "ID3" ) ) {
+         return audio_hash_size();
+      }
+      if( magic( 0, "PK\x03\x04" ) ) {
+         // The compression method of the first entry is at offset 8, 0 means stored.
+         return ( magic( 8, std::string_view( "\x00\x00", 2 ) ) || ( head.size() < 10 ) ) ? size : archive_hash_size();
+      }
+      if( magic( 0, "\x1F\x8B" ) || magic( 0, "BZh" ) || magic( 0, std::string_view( "\xFD" "7zXZ\x00", 6 ) ) || magic( 0, "7z\xBC\xAF\x27\x1C" ) || magic( 0, "Rar!\x1A\x07" ) || magic( 0, "\x28\xB5\x2F\xFD" ) ) {
+         return archive_hash_size();  // GZIP, BZIP2, XZ, 7Z, RAR and ZSTD.
+      }
+      return 0;
    }
 
-   [[nodiscard]] std::size_t hash_size( const std::filesystem::path& path, const std::size_t size )
+   // The file contents take precedence over the file name extension, except for
+   // extensions that were explicitly configured via a --hash-sizes file.
+
+   [[nodiscard]] inline std::size_t hash_size( const std::filesystem::path& path, const std::size_t size, const std::string_view head )
    {
-      const auto data = hash_size_data();
-      const auto iter = data.find( path.extension().native() );
-      return ( iter == data.end() ) ? size : iter->second;
+      const std::string_view extension = hash_size_extension( path );
+
+      if( const auto* entry = hash_size_override( extension ) ) {
+         return entry->second ? entry->second : size;
+      }
+      if( const std::size_t sniffed = hash_size_sniff( head, size ) ) {
+         return sniffed;
+      }
+      const std::size_t result = hash_size_lookup( extension, size );
+      return result ? result : size;
    }
 
 }  // namespace filez
@@ -0,0 +1,78 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "arguments.hpp"
+#include "file_filter.hpp"
+#include "hash_args.hpp"
+#include "host_duplicates.hpp"
+#include "macros.hpp"
+
+bool canonical = true;
+bool recursive = true;
+bool all = false;
+char mode = 'h';
+std::string scan;
+std::string host;
+
+std::vector< std::filesystem::path > paths;
+
+int main( int argc, char** argv )
+{
+   filez::arguments args( paths );
+
+   args.add_bool( 'C', canonical );
+   args.add_bool( 'R', recursive );
+
+   args.add_bool( 'h', []( const std::string_view ){ mode = 'h'; } );
+   args.add_bool( 'H', []( const std::string_view ){ mode = 'H'; } );
+
+   args.add_string( "scan", scan );
+   args.add_string( "host", host );
+   args.add_bool( "all", all );
+
+   filez::add_filter_args( args );
+   filez::add_hash_args( args );
+
+   if( ( !args.parse_nothrow( argc, argv ) ) || paths.empty() ) {
+      FILEZ_STDERR( "Usage: " << argv[ 0 ] << " [OPTION]... --scan FILE DIRECTORY [DIRECTORY]..." );
+      FILEZ_STDERR( "   or: " << argv[ 0 ] << " [OPTION]... FILE [FILE]..." );
+      FILEZ_STDERR( "  Finds duplicate files across multiple hosts in two steps." );
+      FILEZ_STDERR( "  With --scan every host hashes the files in its directories and writes" );
+      FILEZ_STDERR( "    a host file with the size, hash and path of every file to FILE." );
+      FILEZ_STDERR( "  Without --scan the host files of all hosts are merged to find the files" );
+      FILEZ_STDERR( "    with the same size and hash on more than one host." );
+      FILEZ_STDERR( "  Files are duplicates when they have the same..." );
+      FILEZ_STDERR( "    -h   smart hash and size (default)." );
+      FILEZ_STDERR( "    -H   total hash and size." );
+      FILEZ_STDERR( "  Additional options are..." );
+      FILEZ_STDERR( "    -R   to change to non-recursive scanning." );
+      FILEZ_STDERR( "    -C   to disable normalising the given paths." );
+      FILEZ_STDERR( "    --host NAME      to use NAME instead of the host name in the host file." );
+      FILEZ_STDERR( "    --all            to also report duplicates found on a single host." );
+      FILEZ_STDERR( "  The host files to merge must all use the same mode and hash options." );
+      FILEZ_STDERR( "  Special files like devices and pipes are ignored." );
+      filez::print_filter_args_usage();
+      filez::print_hash_args_usage();
+      FILEZ_STDERR( "  The smart hash only hashes two or three small chunks" );
+      FILEZ_STDERR( "    when the file is large and its format, recognised from the" );
+      FILEZ_STDERR( "    first bytes or the extension, is one for which a partial" );
+      FILEZ_STDERR( "    hash is usually sufficient." );
+      FILEZ_STDERR( "  The details are in hash_file.hpp and hash_size.hpp." );
+      return 1;
+   }
+   if( scan.empty() ) {
+      filez::print_host_duplicates( paths, all );
+      return 0;
+   }
+   for( auto& path : paths ) {
+      if( canonical ) {
+         path = std::filesystem::canonical( path );
+      }
+   }
+   filez::scan_host_file( scan, host.empty() ? filez::local_host_name() : host, mode, paths, recursive );
+   filez::print_hash_statistics();
+   return 0;
+}
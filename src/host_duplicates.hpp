@@ -0,0 +1,341 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "file_info.hpp"
+#include "file_info_vector.hpp"
+#include "hash_args.hpp"
+#include "hash_file.hpp"
+#include "hash_schedule.hpp"
+#include "macros.hpp"
+#include "root_scan.hpp"
+
+namespace filez
+{
+   // Duplicates across hosts that don't see each other's filesystems: every host scans and
+   // hashes its directories into a host file with one (size, digest, path) record per regular
+   // file, sorted in that order, and the host files of all hosts are combined with a k-way
+   // merge that only keeps the records with the same size and digest in memory.
+
+   // All integers are 64bit words in host byte order, all strings are preceded by their
+   // length. The file starts with the magic word, the mode 'h' or 'H', the smart hash
+   // configuration from smart_hash_config(), the hash algorithm and the host name, followed
+   // by the records with the size, the lengths of the digest and the path packed into one
+   // word, and these strings.
+
+   constexpr std::string_view host_file_magic = "filez-d2";
+
+   struct host_record
+   {
+      std::size_t size = 0;
+      std::string digest;
+      std::string path;
+   };
+
+   struct host_header
+   {
+      char mode = 'h';
+      std::string config;
+      std::string algorithm;
+      std::string host;
+
+      [[nodiscard]] bool same_hashes( const host_header& other ) const noexcept
+      {
+         // The smart hash configuration doesn't matter for total hashes.
+
+         return ( mode == other.mode ) && ( ( mode == 'H' ) || ( config == other.config ) ) && ( algorithm == other.algorithm );
+      }
+   };
+
+   [[nodiscard]] inline std::string local_host_name()
+   {
+      char buffer[ 256 ] = {};
+
+      if( ::gethostname( buffer, sizeof( buffer ) - 1 ) != 0 ) {
+         FILEZ_ERRNO( "unable to get host name" );
+      }
+      return buffer;
+   }
+
+   class host_file
+   {
+   public:
+      host_file( const std::filesystem::path& path, const char* mode )
+         : m_path( path ),
+           m_file( std::fopen( path.c_str(), mode ) )
+      {
+         if( !m_file ) {
+            FILEZ_ERRNO( "unable to open host file " << path );
+         }
+      }
+
+      host_file( host_file&& ) = delete;
+      host_file( const host_file& ) = delete;
+
+      void operator=( host_file&& ) = delete;
+      void operator=( const host_file& ) = delete;
+
+      void write_header( const host_header& header )
+      {
+         write_bytes( host_file_magic );
+         write_word( std::uint64_t( header.mode ) );
+         write_string( header.config );
+         write_string( header.algorithm );
+         write_string( header.host );
+      }
+
+      void write_record( const host_record& r )
+      {
+         write_word( r.size );
+         write_word( ( std::uint64_t( r.digest.size() ) << 32 ) | r.path.size() );
+         write_bytes( r.digest );
+         write_bytes( r.path );
+      }
+
+      void close()
+      {
+         if( std::fclose( m_file.release() ) != 0 ) {
+            FILEZ_ERRNO( "unable to write host file " << m_path );
+         }
+      }
+
+      [[nodiscard]] host_header read_header()
+      {
+         std::string magic( host_file_magic.size(), '\0' );
+         std::uint64_t mode;
+
+         if( ( !read_bytes( magic ) ) || ( magic != host_file_magic ) || ( !read_word( mode ) ) ) {
+            FILEZ_ERROR( "file " << m_path << " is not a host file" );
+         }
+         host_header result;
+         result.mode = char( mode );
+         result.config = read_string();
+         result.algorithm = read_string();
+         result.host = read_string();
+         return result;
+      }
+
+      // Returns false at the end of the file.
+
+      [[nodiscard]] bool read_record( host_record& r )
+      {
+         std::uint64_t size;
+         std::uint64_t lengths;
+
+         if( !read_word( size ) ) {
+            return false;
+         }
+         if( !read_word( lengths ) ) {
+            FILEZ_ERROR( "truncated host file " << m_path );
+         }
+         r.size = std::size_t( size );
+         r.digest.resize( std::size_t( lengths >> 32 ) );
+         r.path.resize( std::size_t( lengths & 0xffffffff ) );
+
+         if( ( !read_bytes( r.digest ) ) || ( !read_bytes( r.path ) ) ) {
+            FILEZ_ERROR( "truncated host file " << m_path );
+         }
+         return true;
+      }
+
+   private:
+      struct file_closer
+      {
+         void operator()( std::FILE* file ) const noexcept
+         {
+            (void)std::fclose( file );
+         }
+      };
+
+      const std::filesystem::path m_path;
+      std::unique_ptr< std::FILE, file_closer > m_file;
+
+      void write_word( const std::uint64_t word )
+      {
+         if( std::fwrite( &word, sizeof( word ), 1, m_file.get() ) != 1 ) {
+            FILEZ_ERRNO( "unable to write host file " << m_path );
+         }
+      }
+
+      void write_bytes( const std::string_view bytes )
+      {
+         if( std::fwrite( bytes.data(), 1, bytes.size(), m_file.get() ) != bytes.size() ) {
+            FILEZ_ERRNO( "unable to write host file " << m_path );
+         }
+      }
+
+      void write_string( const std::string_view string )
+      {
+         write_word( string.size() );
+         write_bytes( string );
+      }
+
+      [[nodiscard]] bool read_word( std::uint64_t& word )
+      {
+         if( std::fread( &word, sizeof( word ), 1, m_file.get() ) == 1 ) {
+            return true;
+         }
+         if( std::ferror( m_file.get() ) ) {
+            FILEZ_ERRNO( "unable to read host file " << m_path );
+         }
+         return false;
+      }
+
+      [[nodiscard]] bool read_bytes( std::string& bytes )
+      {
+         if( std::fread( bytes.data(), 1, bytes.size(), m_file.get() ) == bytes.size() ) {
+            return true;
+         }
+         if( std::ferror( m_file.get() ) ) {
+            FILEZ_ERRNO( "unable to read host file " << m_path );
+         }
+         return false;
+      }
+
+      [[nodiscard]] std::string read_string()
+      {
+         std::uint64_t size;
+
+         if( !read_word( size ) ) {
+            FILEZ_ERROR( "truncated host file " << m_path );
+         }
+         std::string result( std::size_t( size ), '\0' );
+
+         if( !read_bytes( result ) ) {
+            FILEZ_ERROR( "truncated host file " << m_path );
+         }
+         return result;
+      }
+   };
+
+   // The scan step on every host: hashes all regular files found under the paths with
+   // the smart hash for mode 'h' or the total hash for mode 'H' and writes the host file.
+
+   inline void scan_host_file( const std::filesystem::path& file, const std::string& host, const char mode, const std::vector< std::filesystem::path >& paths, const bool recursive )
+   {
+      std::vector< file_info_vector > lists( paths.size() );
+
+      for_each_root_concurrently( paths, [ & ]( const std::size_t i ){
+         lists[ i ] = recursive ? make_full_file_info_vector( paths[ i ] ) : make_file_info_vector( paths[ i ] );
+      } );
+      std::vector< file_info* > files;
+
+      for( const auto& list : lists ) {
+         for( const auto& fi : list ) {
+            if( fi->is_file() ) {
+               files.emplace_back( fi.get() );
+            }
+         }
+      }
+      schedule_hashing( files, [ & ]( file_info& fi ){ (void)( ( mode == 'H' ) ? fi.total_hash() : fi.smart_hash() ); } );
+
+      std::vector< host_record > records;
+      records.reserve( files.size() );
+
+      for( file_info* fi : files ) {
+         records.emplace_back( fi->stat().size(), ( mode == 'H' ) ? fi->total_hash() : fi->smart_hash(), fi->path().native() );
+      }
+      std::sort( records.begin(), records.end(), []( const host_record& l, const host_record& r ){
+         return std::tie( l.size, l.digest, l.path ) < std::tie( r.size, r.digest, r.path );
+      } );
+      host_file out( file, "wb" );
+      out.write_header( { mode, smart_hash_config(), global_hash_args().algorithm, host } );
+
+      for( const auto& r : records ) {
+         out.write_record( r );
+      }
+      out.close();
+   }
+
+   // The merge step: reads the host files of all hosts in parallel and calls f( header, group, hosts )
+   // for every group of records with the same size and digest, with the header of the first file
+   // and the host name of every record, ordered by host and path, in the order of increasing size.
+
+   template< typename F >
+   void merge_host_files( const std::vector< std::filesystem::path >& paths, F&& f )
+   {
+      std::vector< std::unique_ptr< host_file > > files;
+      std::vector< host_header > headers;
+      std::vector< host_record > heads( paths.size() );
+
+      for( const auto& path : paths ) {
+         headers.emplace_back( files.emplace_back( std::make_unique< host_file >( path, "rb" ) )->read_header() );
+
+         if( !headers.back().same_hashes( headers.front() ) ) {
+            FILEZ_ERROR( "host file " << path << " was made with a different mode or hash options than " << paths.front() );
+         }
+      }
+      const auto key = [ & ]( const std::size_t i ){ return std::tie( heads[ i ].size, heads[ i ].digest, headers[ i ].host, heads[ i ].path ); };
+      const auto greater = [ & ]( const std::size_t l, const std::size_t r ){ return key( r ) < key( l ); };
+      std::priority_queue< std::size_t, std::vector< std::size_t >, decltype( greater ) > queue( greater );
+
+      for( std::size_t i = 0; i < files.size(); ++i ) {
+         if( files[ i ]->read_record( heads[ i ] ) ) {
+            queue.push( i );
+         }
+      }
+      std::vector< host_record > group;
+      std::vector< std::string_view > hosts;
+
+      const auto flush_group = [ & ](){
+         if( !group.empty() ) {
+            f( headers.front(), group, hosts );
+         }
+         group.clear();
+         hosts.clear();
+      };
+      while( !queue.empty() ) {
+         const std::size_t i = queue.top();
+         queue.pop();
+
+         if( ( !group.empty() ) && ( ( group.front().size != heads[ i ].size ) || ( group.front().digest != heads[ i ].digest ) ) ) {
+            flush_group();
+         }
+         group.emplace_back( std::move( heads[ i ] ) );
+         hosts.emplace_back( headers[ i ].host );
+
+         if( files[ i ]->read_record( heads[ i ] ) ) {
+            queue.push( i );
+         }
+      }
+      flush_group();
+   }
+
+   // Prints the groups of files with the same size and digest that are found on more than
+   // one host or, when all is set, also those that are only found on a single host.
+
+   inline void print_host_duplicates( const std::vector< std::filesystem::path >& paths, const bool all )
+   {
+      merge_host_files( paths, [ & ]( const host_header& header, const std::vector< host_record >& group, const std::vector< std::string_view >& hosts ){
+         std::size_t count = 1;  // The hosts are sorted, so every change is another host.
+
+         for( std::size_t i = 1; i < hosts.size(); ++i ) {
+            count += ( hosts[ i ] != hosts[ i - 1 ] );
+         }
+
+         if( ( group.size() > 1 ) && ( all || ( count > 1 ) ) ) {
+            FILEZ_STDOUT( group.size() << " duplicates on " << count << " hosts with same size " << group.front().size << " and same " << ( ( header.mode == 'H' ) ? "total" : "smart" ) << " hash" );
+
+            for( std::size_t i = 0; i < group.size(); ++i ) {
+               FILEZ_STDOUT( "   " << hosts[ i ] << ':' << std::filesystem::path( group[ i ].path ) );
+            }
+         }
+      } );
+   }
+
+}  // namespace filez
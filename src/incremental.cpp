@@ -4,6 +4,8 @@
 #include <vector>
 
 #include "arguments.hpp"
+#include "file_filter.hpp"
+#include "hash_args.hpp"
 #include "incremental_args.hpp"
 #include "incremental_work.hpp"
 #include "macros.hpp"
@@ -24,6 +26,10 @@ int main( int argc, char** argv )
    args.add_bool( 'x', fia.x );
    args.add_size( 'c', fia.c );
 
+   filez::global_filter_args().exclude.emplace_back( ".DS_Store" );
+   filez::add_filter_args( args );
+   filez::add_hash_args( args );
+
    if( ( !args.parse_nothrow( argc, argv ) ) || ( paths.size() < 2 ) || ( !fia.valid() ) ) {
       FILEZ_STDERR( "Usage: " << argv[ 0 ] << " [options]... <source_dir> [old_backup]... <new_backup>" );
       FILEZ_STDERR( "  Creates a new directory hierarchy under new_backup that mirrors source_dir." );
@@ -40,17 +46,19 @@ int main( int argc, char** argv )
       FILEZ_STDERR( "    -c N Copy instead of hard link all files smaller than N, default 0." );
       FILEZ_STDERR( "  Options can be combined, e.g. -hP (or -h -P) will search according to both -h and -P." );
       FILEZ_STDERR( "  At least one option different from -c must be given -- though everything except -x is a nop without an old_backup." );
+      FILEZ_STDERR( "  The filter options only apply to source_dir, files named .DS_Store are always excluded." );
+      filez::print_filter_args_usage();
+      filez::print_hash_args_usage();
       FILEZ_STDERR( "  The smart hash only hashes two or three small chunks" );
-      FILEZ_STDERR( "    when the file is large and the extension is one for" );
-      FILEZ_STDERR( "    which a partial hash is usually sufficient." );
+      FILEZ_STDERR( "    when the file is large and its format, recognised from the" );
+      FILEZ_STDERR( "    first bytes or the extension, is one for which a partial" );
+      FILEZ_STDERR( "    hash is usually sufficient." );
       FILEZ_STDERR( "  The details are in hash_file.hpp and hash_size.hpp." );
       return 1;
    }
-   filez::incremental_work incremental( paths.front(), paths.back(), fia );
-
-   for( std::size_t i = 1; i + 1 < paths.size(); ++i ) {
-      incremental.add( paths[ i ] );
-   }
+   const std::vector< std::filesystem::path > old_backups( paths.begin() + 1, paths.end() - 1 );
+   filez::incremental_work incremental( paths.front(), old_backups, paths.back(), fia );
    incremental.backup();
+   filez::print_hash_statistics();
    return 0;
 }
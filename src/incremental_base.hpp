@@ -3,51 +3,27 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "file_info_maps.hpp"
 #include "file_info_sets.hpp"
 #include "file_stat.hpp"
 #include "macros.hpp"
+#include "root_scan.hpp"
 #include "utility.hpp"
 
 namespace filez
 {
    class incremental_base
    {
-   public:
-      void add( const std::filesystem::path& old_backup )
-      {
-         const auto old_path = std::filesystem::canonical( old_backup );
-         const file_stat old_stat( old_path );
-
-         FILEZ_STDOUT( "Scanning old backup " << old_path << "..." );
-
-         if( !old_stat.is_dir() ) {
-            FILEZ_ERROR( "old backup path " << old_path << " is not a directory" );
-         }
-         if( m_src_stat.device() == old_stat.device() ) {
-            FILEZ_ERROR( "source " << m_src_path << " and old backup " << old_path << " are on the same filesystem" );
-         }
-         if( old_stat.device() != m_new_stat.device() ) {
-            FILEZ_ERROR( "old backup " << old_path << " and new backup " << m_new_path << " are not on the same filesystem" );
-         }
-         if( !independent( m_src_path, old_path ) ) {
-            FILEZ_ERROR( "source " << m_src_path << " and old backup " << old_path << " are not independent" );
-         }
-         if( !independent( old_path, m_new_path ) ) {
-            FILEZ_ERROR( "old backup " << old_path << " and new backup " << m_new_path << " are not independent" );
-         }
-         make_file_info_by_size_map_impl< file_info_by_size_map, std::filesystem::recursive_directory_iterator >( m_old_files, old_path );
-      }
-
    protected:
-      incremental_base( const std::filesystem::path& source_dir, const std::filesystem::path& new_backup )
+      incremental_base( const std::filesystem::path& source_dir, const std::vector< std::filesystem::path >& old_backups, const std::filesystem::path& new_backup )
          : m_src_path( std::filesystem::canonical( source_dir ) ),
            m_new_path( initialize_new_path( new_backup ) ),
            m_src_stat( m_src_path ),
-           m_new_stat( m_new_path ),
-           m_src_files( make_full_file_info_by_path_set( m_src_path ) )
+           m_new_stat( m_new_path )
       {
          if( !m_src_stat.is_dir() ) {
             FILEZ_ERROR( "source path " << m_src_path << " is not a directory" );
@@ -58,6 +34,12 @@ namespace filez
          if( !independent( m_src_path, m_new_path ) ) {
             FILEZ_ERROR( "source " << m_src_path << " and new backup " << m_new_path << " are not independent" );
          }
+         std::vector< std::filesystem::path > roots = { m_src_path };
+
+         for( const auto& old_backup : old_backups ) {
+            roots.emplace_back( check_old_backup( old_backup ) );
+         }
+         scan( roots );
       }
 
       void add( const std::shared_ptr< file_info >& copied )
@@ -71,7 +53,7 @@ namespace filez
       const file_stat m_src_stat;
       const file_stat m_new_stat;
 
-      const file_info_by_path_set m_src_files;
+      file_info_by_path_set m_src_files;
       file_info_by_size_map m_old_files;
 
    private:
@@ -85,6 +67,61 @@ namespace filez
          }
          return std::filesystem::canonical( new_backup );
       }
+
+      [[nodiscard]] std::filesystem::path check_old_backup( const std::filesystem::path& old_backup ) const
+      {
+         const auto old_path = std::filesystem::canonical( old_backup );
+         const file_stat old_stat( old_path );
+
+         FILEZ_STDOUT( "Scanning old backup " << old_path << "..." );
+
+         if( !old_stat.is_dir() ) {
+            FILEZ_ERROR( "old backup path " << old_path << " is not a directory" );
+         }
+         if( m_src_stat.device() == old_stat.device() ) {
+            FILEZ_ERROR( "source " << m_src_path << " and old backup " << old_path << " are on the same filesystem" );
+         }
+         if( old_stat.device() != m_new_stat.device() ) {
+            FILEZ_ERROR( "old backup " << old_path << " and new backup " << m_new_path << " are not on the same filesystem" );
+         }
+         if( !independent( m_src_path, old_path ) ) {
+            FILEZ_ERROR( "source " << m_src_path << " and old backup " << old_path << " are not independent" );
+         }
+         if( !independent( old_path, m_new_path ) ) {
+            FILEZ_ERROR( "old backup " << old_path << " and new backup " << m_new_path << " are not independent" );
+         }
+         return old_path;
+      }
+
+      // The source is on another filesystem than the old backups, so at least the source
+      // and the old backups are walked concurrently. The files of the old backups are
+      // merged in the order in which the old backups were given. The filter options only
+      // apply to the source, all files in the old backups remain candidates for linking.
+
+      void scan( const std::vector< std::filesystem::path >& roots )
+      {
+         std::vector< file_info_by_size_map > olds( roots.size() );
+
+         for_each_root_concurrently( roots, [ & ]( const std::size_t i ){
+            if( i == 0 ) {
+               m_src_files = make_full_file_info_by_path_set( roots[ i ] );
+            }
+            else {
+               for( const auto& de : std::filesystem::recursive_directory_iterator( roots[ i ] ) ) {
+                  const auto fi = std::make_shared< file_info >( de.path() );
+                  if( fi->stat().is_file() ) {
+                     olds[ i ].try_emplace( fi->stat().size() ).first->second.emplace_back( fi );
+                  }
+               }
+            }
+         } );
+         for( auto& old : olds ) {
+            for( auto& [ size, files ] : old ) {
+               auto& v = m_old_files[ size ];
+               v.insert( v.end(), files.begin(), files.end() );
+            }
+         }
+      }
    };
 
 }  // namespace filez
@@ -3,12 +3,16 @@
 #pragma once
 
 #include <filesystem>
+#include <set>
+#include <string>
 #include <unistd.h>
+#include <vector>
 
 #include "filesystem.hpp"
 #include "file_info.hpp"
 #include "file_info_maps.hpp"
 #include "file_info_sets.hpp"
+#include "hash_schedule.hpp"
 #include "incremental_args.hpp"
 #include "incremental_base.hpp"
 #include "macros.hpp"
@@ -20,19 +24,20 @@ namespace filez
       : public incremental_base
    {
    public:
-      incremental_work( const std::filesystem::path& source_dir, const std::filesystem::path new_backup, const incremental_args args )
-         : incremental_base( source_dir, new_backup ),
+      incremental_work( const std::filesystem::path& source_dir, const std::vector< std::filesystem::path >& old_backups, const std::filesystem::path new_backup, const incremental_args args )
+         : incremental_base( source_dir, old_backups, new_backup ),
            m_args( args )
       {
          FILEZ_STDOUT( "Creating directory hierarchy..." );
-         constexpr auto opts = std::filesystem::copy_options::recursive | std::filesystem::copy_options::directories_only | std::filesystem::copy_options::skip_symlinks;
-         std::filesystem::copy( m_src_path, m_new_path, opts );  // TODO: This is slower than expected, optimise?
+         copy_directories( m_src_path, m_new_path );
       }
 
       void backup()
       {
          FILEZ_STDOUT( "Copying and hard linking files..." );
 
+         prehash();
+
          for( const auto& fi : m_src_files ) {
             if( fi->stat().is_file() ) {
                backup( *fi );
@@ -56,11 +61,54 @@ namespace filez
 
       const incremental_args m_args;
 
-      void backup( file_info& fi )
+      // Computes all hashes that backup_link() might need up-front, when
+      // enabled with the hashing options, e.g. concurrently per device.
+
+      void prehash()
       {
-         if( fi.path().native().ends_with( ".DS_Store" ) ) {
+         if( ( !m_args.h ) && ( !m_args.n ) && ( !m_args.H ) && ( !m_args.N ) ) {
             return;
          }
+         std::vector< file_info* > files;
+         std::set< file_info* > olds;
+
+         for( const auto& fi : m_src_files ) {
+            if( fi->stat().is_file() && ( fi->stat().size() > 0 ) && ( fi->stat().size() >= m_args.c ) ) {
+               if( const auto iter = m_old_files.find( fi->stat().size() ); iter != m_old_files.end() ) {
+                  files.emplace_back( fi.get() );
+
+                  for( const auto& of : iter->second ) {
+                     if( olds.emplace( of.get() ).second ) {
+                        files.emplace_back( of.get() );
+                     }
+                  }
+               }
+            }
+         }
+         schedule_hashing( files, [ this ]( file_info& fi ) {
+            if( m_args.h || m_args.n ) {
+               (void)fi.smart_hash();
+            }
+            else if( m_args.H || m_args.N ) {
+               (void)fi.total_hash();
+            }
+         } );
+      }
+
+      // The smart hashes are calculated on their own since they usually don't read the whole
+      // file; only when the total hash of a file is needed before its smart hash, e.g. for an
+      // old file with another name that -n skipped, both are calculated in a single pass.
+
+      [[nodiscard]] const std::string& total_hash( file_info& fi ) const
+      {
+         if( ( m_args.h || m_args.n ) && ( m_args.H || m_args.N ) ) {
+            fi.both_hashes();
+         }
+         return fi.total_hash();
+      }
+
+      void backup( file_info& fi )
+      {
          const auto to = transfer( fi.path(), m_src_path, m_new_path );
 
          if( fi.stat().size() == 0 ) {
@@ -131,7 +179,7 @@ namespace filez
                FILEZ_ASSERT( !fi.path().filename().empty() );
                FILEZ_ASSERT( !of->path().filename().empty() );
 
-               if( ( fi.path().filename() == of->path().filename() ) && ( of->total_hash() == fi.total_hash() ) ) {
+               if( ( fi.path().filename() == of->path().filename() ) && ( total_hash( *of ) == total_hash( fi ) ) ) {
                   backup_link_impl( *of, to );
                   return true;
                }
@@ -139,7 +187,7 @@ namespace filez
          }
          if( m_args.N ) {
             for( const std::shared_ptr< file_info >& of : iter->second ) {
-               if( of->total_hash() == fi.total_hash() ) {
+               if( total_hash( *of ) == total_hash( fi ) ) {
                   backup_link_impl( *of, to );
                   return true;
                }
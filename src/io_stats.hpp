@@ -0,0 +1,32 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include "macros.hpp"
+
+namespace filez
+{
+   struct io_stats
+   {
+      std::atomic< std::size_t > bytes_read = 0;
+      std::atomic< std::size_t > bytes_cached = 0;  // Subset of bytes_read that was already in the page cache.
+   };
+
+   [[nodiscard]] inline io_stats& global_io_stats() noexcept
+   {
+      static io_stats stats;
+      return stats;
+   }
+
+   inline void print_io_stats()
+   {
+      const io_stats& stats = global_io_stats();
+
+      FILEZ_STDOUT( "Bytes read: " << stats.bytes_read );
+      FILEZ_STDOUT( "Bytes from cache: " << stats.bytes_cached );
+   }
+
+}  // namespace filez
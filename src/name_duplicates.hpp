@@ -2,11 +2,8 @@
 
 #pragma once
 
-#include <map>
-#include <memory>
-#include <vector>
-
 #include "file_info_vector.hpp"
+#include "group_pipeline.hpp"
 #include "macros.hpp"
 
 namespace filez
@@ -18,30 +15,22 @@ namespace filez
 
       void add( const file_info_vector& list )
       {
-         for( const auto& sp : list ) {
-            if( sp->stat().is_file() ) {
-               m_map.try_emplace( sp->path().filename() ).first->second.emplace_back( sp );
-            }
-         }
+         m_pipeline.add( list );
       }
 
       void work()
       {
-         for( const auto& kv : m_map ) {
-            FILEZ_ASSERT( !kv.second.empty() );
-
-            if( kv.second.size() > 1 ) {
-               FILEZ_STDOUT( kv.second.size() << " duplicates of file name " << kv.first );
+         for( const auto& group : m_pipeline.groups() ) {
+            FILEZ_STDOUT( group.size() << " duplicates of file name " << group.front()->path().filename() );
 
-               for( const auto& fi : kv.second ) {
-                  FILEZ_STDOUT( "   " << fi->path() );
-               }
+            for( const auto& fi : group ) {
+               FILEZ_STDOUT( "   " << fi->path() );
             }
          }
       }
 
    private:
-      std::map< std::filesystem::path, std::vector< std::shared_ptr< file_info > > > m_map;
+      group_pipeline< name_key > m_pipeline;
    };
 
 }  // namespace filez
@@ -2,11 +2,8 @@
 
 #pragma once
 
-#include <map>
-#include <memory>
-#include <vector>
-
 #include "file_info_vector.hpp"
+#include "group_pipeline.hpp"
 #include "macros.hpp"
 
 namespace filez
@@ -18,30 +15,22 @@ namespace filez
 
       void add( const file_info_vector& list )
       {
-         for( const auto& sp : list ) {
-            if( sp->stat().is_file() ) {
-               m_map.try_emplace( std::make_pair( sp->stat().size(), sp->path().filename() ) ).first->second.emplace_back( sp );
-            }
-         }
+         m_pipeline.add( list );
       }
 
       void work()
       {
-         for( const auto& kv : m_map ) {
-            FILEZ_ASSERT( !kv.second.empty() );
-
-            if( kv.second.size() > 1 ) {
-               FILEZ_STDOUT( kv.second.size() << " duplicates of file name " << kv.first.second << " with same size " << kv.first.first );
+         for( const auto& group : m_pipeline.groups() ) {
+            FILEZ_STDOUT( group.size() << " duplicates of file name " << group.front()->path().filename() << " with same size " << group.front()->stat().size() );
 
-               for( const auto& fi : kv.second ) {
-                  FILEZ_STDOUT( "   " << fi->path() );
-               }
+            for( const auto& fi : group ) {
+               FILEZ_STDOUT( "   " << fi->path() );
             }
          }
       }
 
    private:
-      std::map< std::pair< std::size_t, std::filesystem::path >, std::vector< std::shared_ptr< file_info > > > m_map;
+      group_pipeline< size_key, name_key > m_pipeline;
    };
 
 }  // namespace filez
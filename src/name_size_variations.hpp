@@ -2,11 +2,8 @@
 
 #pragma once
 
-#include <map>
-#include <memory>
-#include <vector>
-
 #include "file_info_vector.hpp"
+#include "group_pipeline.hpp"
 #include "macros.hpp"
 
 namespace filez
@@ -18,34 +15,26 @@ namespace filez
 
       void add( const file_info_vector& list )
       {
-         for( const auto& sp : list ) {
-            if( sp->stat().is_file() ) {
-               m_map.try_emplace( sp->path().filename() ).first->second.try_emplace( sp->stat().size() ).first->second.emplace_back( sp );
-            }
-         }
+         m_pipeline.add( list );
       }
 
       void work()
       {
-         for( const auto& kv : m_map ) {
-            FILEZ_ASSERT( !kv.second.empty() );
-
-            if( kv.second.size() > 1 ) {
-               FILEZ_STDOUT( kv.second.size() << " size variations for file name " << kv.first );
+         for( const auto& parts : m_pipeline.variations< size_key >() ) {
+            FILEZ_STDOUT( parts.size() << " size variations for file name " << parts.front().front()->path().filename() );
 
-               for( const auto& sv : kv.second ) {
-                  FILEZ_STDOUT( " size " << sv.first );
+            for( const auto& group : parts ) {
+               FILEZ_STDOUT( " size " << group.front()->stat().size() );
 
-                  for( const auto& fi : sv.second ) {
-                     FILEZ_STDOUT( "   " << fi->path() );
-                  }
+               for( const auto& fi : group ) {
+                  FILEZ_STDOUT( "   " << fi->path() );
                }
             }
          }
       }
 
    private:
-      std::map< std::filesystem::path, std::map< std::size_t, std::vector< std::shared_ptr< file_info > > > > m_map;
+      group_pipeline< name_key > m_pipeline;
    };
 
 }  // namespace filez
@@ -2,11 +2,9 @@
 
 #pragma once
 
-#include <map>
-#include <memory>
-#include <vector>
-
 #include "file_info_vector.hpp"
+#include "file_stat.hpp"
+#include "group_pipeline.hpp"
 #include "macros.hpp"
 
 namespace filez
@@ -18,32 +16,25 @@ namespace filez
 
       void add( const file_info_vector& list )
       {
-         for( const auto& sp : list ) {
-            if( sp->stat().is_file() ) {
-               m_map.try_emplace( sp->stat().node() ).first->second.try_emplace( sp->path().filename() ).first->second.emplace_back( sp );
-            }
-         }
+         m_pipeline.add( list );
       }
 
       void work()
       {
-         for( const auto& kv : m_map ) {
-            FILEZ_ASSERT( !kv.second.empty() );
-
-            if( kv.second.size() > 1 ) {
-               FILEZ_STDOUT( kv.second.size() << " name variations for device " << kv.first.first << " inode " << kv.first.second );
+         for( const auto& parts : m_pipeline.variations< name_key >() ) {
+            const file_node node = parts.front().front()->stat().node();
+            FILEZ_STDOUT( parts.size() << " name variations for device " << node.first << " inode " << node.second );
 
-               for( const auto& sv : kv.second ) {
-                  for( const auto& fi : sv.second ) {
-                     FILEZ_STDOUT( "   " << fi->path() );
-                  }
+            for( const auto& group : parts ) {
+               for( const auto& fi : group ) {
+                  FILEZ_STDOUT( "   " << fi->path() );
                }
             }
          }
       }
 
    private:
-      std::map< file_node, std::map< std::filesystem::path, std::vector< std::shared_ptr< file_info > > > > m_map;
+      group_pipeline< node_key > m_pipeline;
    };
 
 }  // namespace filez
@@ -0,0 +1,53 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "macros.hpp"
+#include "system.hpp"
+
+namespace filez
+{
+   // Determines which pages of the given (page-aligned) file range are currently
+   // in the page cache without actually reading (and thereby caching) anything.
+   // Returns the number of resident pages, the per-page flags are in pages.
+
+   [[nodiscard]] inline std::size_t resident_pages( const int fd, const std::size_t offset, const std::size_t length, std::vector< unsigned char >& pages )
+   {
+      FILEZ_ASSERT( offset == rounded_down_to_pagesize( offset ) );
+
+      pages.assign( rounded_up_to_pagesize( length ) / get_pagesize(), 0 );
+
+      if( length == 0 ) {
+         return 0;
+      }
+      void* addr = ::mmap( nullptr, length, PROT_READ, MAP_SHARED, fd, offset );
+
+      if( addr == MAP_FAILED ) {
+         return 0;  // Unknown is treated like not resident.
+      }
+#if defined( __APPLE__ )
+      const int rc = ::mincore( addr, length, reinterpret_cast< char* >( pages.data() ) );
+#else
+      const int rc = ::mincore( addr, length, pages.data() );
+#endif
+      ::munmap( addr, length );
+
+      if( rc != 0 ) {
+         pages.assign( pages.size(), 0 );
+         return 0;
+      }
+      std::size_t result = 0;
+
+      for( auto& page : pages ) {
+         page &= 1;
+         result += page;
+      }
+      return result;
+   }
+
+}  // namespace filez
@@ -0,0 +1,82 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace filez
+{
+   // The device on which the directory iterators will walk, i.e. following a symlink; any
+   // error is left to be reported by the walk itself.
+
+   [[nodiscard]] inline ::dev_t root_device( const std::filesystem::path& path ) noexcept
+   {
+      struct ::stat st;
+      return ( ::stat( path.c_str(), &st ) == 0 ) ? st.st_dev : 0;
+   }
+
+   // Calls f( i ) for all indices i of the roots, concurrently with one thread per device
+   // for roots on different devices, and one after the other in the given order for roots
+   // on the same device, which would only compete for the same disk. The callers store the
+   // results by index and merge them in the order of the roots so that the outcome doesn't
+   // depend on the timing. The exception of the first root that failed, in the order of the
+   // roots, is re-thrown after all threads finished.
+
+   template< typename F >
+   void for_each_root_concurrently( const std::vector< std::filesystem::path >& roots, F&& f )
+   {
+      std::map< ::dev_t, std::vector< std::size_t > > devices;
+
+      for( std::size_t i = 0; i < roots.size(); ++i ) {
+         devices[ root_device( roots[ i ] ) ].emplace_back( i );
+      }
+      if( devices.size() < 2 ) {
+         for( std::size_t i = 0; i < roots.size(); ++i ) {
+            f( i );
+         }
+         return;
+      }
+      std::vector< std::exception_ptr > errors( roots.size() );
+      std::vector< std::thread > threads;
+
+      const auto join = [ & ](){
+         for( auto& thread : threads ) {
+            thread.join();
+         }
+      };
+      try {
+         for( const auto& d : devices ) {
+            threads.emplace_back( [ & ](){
+               for( const std::size_t i : d.second ) {
+                  try {
+                     f( i );
+                  }
+                  catch( ... ) {
+                     errors[ i ] = std::current_exception();
+                     return;
+                  }
+               }
+            } );
+         }
+      }
+      catch( ... ) {
+         join();  // When a thread could not be started, the running ones must finish before re-throwing.
+         throw;
+      }
+      join();
+      for( const auto& error : errors ) {
+         if( error ) {
+            std::rethrow_exception( error );
+         }
+      }
+   }
+
+}  // namespace filez
@@ -0,0 +1,235 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "file_info.hpp"
+#include "file_info_vector.hpp"
+#include "file_mmap.hpp"
+#include "file_stat.hpp"
+#include "hash_args.hpp"
+#include "hash_file.hpp"
+#include "macros.hpp"
+
+namespace filez
+{
+   // The directory entries found under some roots, with the parts of their stat that the
+   // tools use and the hashes known at the time, so that the analysis can be repeated with
+   // other modes or options without scanning the filesystem again.
+
+   struct scan_snapshot
+   {
+      std::vector< std::filesystem::path > roots;
+      std::vector< file_info_vector > lists;  // One per root, in the same order.
+   };
+
+   // All integers are 64bit words in host byte order, all strings are preceded by their
+   // length and padded with zeroes to a multiple of 8 bytes. The file starts with the magic
+   // word, the number of roots and the smart hash configuration from smart_hash_config(),
+   // followed by the path and the number of entries of every root and these entries with
+   // the size, the mtime, the device, the inode, the type and link count, the lengths of the
+   // path, the smart and the total hash packed into one word, and then these three strings
+   // without their lengths.
+
+   constexpr std::string_view scan_snapshot_magic = "filez-s2";
+
+   class scan_snapshot_writer
+   {
+   public:
+      explicit scan_snapshot_writer( const std::filesystem::path& path )
+         : m_path( path ),
+           m_file( std::fopen( path.c_str(), "wb" ) )
+      {
+         if( !m_file ) {
+            FILEZ_ERRNO( "unable to open scan snapshot " << path << " for writing" );
+         }
+      }
+
+      scan_snapshot_writer( scan_snapshot_writer&& ) = delete;
+      scan_snapshot_writer( const scan_snapshot_writer& ) = delete;
+
+      void operator=( scan_snapshot_writer&& ) = delete;
+      void operator=( const scan_snapshot_writer& ) = delete;
+
+      void write( const scan_snapshot& snapshot )
+      {
+         write_bytes( scan_snapshot_magic );
+         write_word( snapshot.roots.size() );
+         const std::string config = smart_hash_config();
+         write_word( config.size() );
+         write_bytes( config );
+
+         for( std::size_t i = 0; i < snapshot.roots.size(); ++i ) {
+            write_word( snapshot.roots[ i ].native().size() );
+            write_bytes( snapshot.roots[ i ].native() );
+            write_word( snapshot.lists[ i ].size() );
+
+            for( const auto& fi : snapshot.lists[ i ] ) {
+               write_entry( *fi );
+            }
+         }
+         if( std::fclose( m_file.release() ) != 0 ) {
+            FILEZ_ERRNO( "unable to write scan snapshot " << m_path );
+         }
+      }
+
+   private:
+      struct file_closer
+      {
+         void operator()( std::FILE* file ) const noexcept
+         {
+            (void)std::fclose( file );
+         }
+      };
+
+      const std::filesystem::path m_path;
+      std::unique_ptr< std::FILE, file_closer > m_file;
+
+      void write_word( const std::uint64_t word )
+      {
+         if( std::fwrite( &word, sizeof( word ), 1, m_file.get() ) != 1 ) {
+            FILEZ_ERRNO( "unable to write scan snapshot " << m_path );
+         }
+      }
+
+      void write_bytes( const std::string_view bytes )
+      {
+         static const char zeroes[ 8 ] = {};
+         const std::size_t padding = ( 8 - bytes.size() % 8 ) % 8;
+
+         if( ( std::fwrite( bytes.data(), 1, bytes.size(), m_file.get() ) != bytes.size() ) || ( std::fwrite( zeroes, 1, padding, m_file.get() ) != padding ) ) {
+            FILEZ_ERRNO( "unable to write scan snapshot " << m_path );
+         }
+      }
+
+      void write_entry( file_info& fi )
+      {
+         const file_stat& stat = fi.stat();
+         const std::string& path = fi.path().native();
+         const std::string& smart = fi.known_smart_hash();
+         const std::string& total = fi.known_total_hash();
+
+         if( ( path.size() > 0xffffffff ) || ( smart.size() > 0xffff ) || ( total.size() > 0xffff ) ) {
+            FILEZ_ERROR( "unable to write scan snapshot entry for path " << fi.path() );
+         }
+         write_word( stat.size() );
+         write_word( std::uint64_t( stat.mtime() ) );
+         write_word( stat.device() );
+         write_word( stat.inode() );
+         write_word( ( std::uint64_t( stat.type() ) << 32 ) | std::uint32_t( stat.links() ) );
+         write_word( ( std::uint64_t( path.size() ) << 32 ) | ( smart.size() << 16 ) | total.size() );
+         write_bytes( path );
+         write_bytes( smart );
+         write_bytes( total );
+      }
+   };
+
+   // Reads a scan snapshot from a memory mapping of the file. Hashes that don't fit the
+   // current hash options, i.e. a different algorithm or, for smart hashes, a different
+   // number of samples or different --hash-sizes overrides, are dropped and, when needed,
+   // calculated again from the files.
+
+   class scan_snapshot_reader
+   {
+   public:
+      explicit scan_snapshot_reader( const std::filesystem::path& path )
+         : m_path( path ),
+           m_mmap( path )
+      {}
+
+      scan_snapshot_reader( scan_snapshot_reader&& ) = delete;
+      scan_snapshot_reader( const scan_snapshot_reader& ) = delete;
+
+      void operator=( scan_snapshot_reader&& ) = delete;
+      void operator=( const scan_snapshot_reader& ) = delete;
+
+      [[nodiscard]] scan_snapshot read()
+      {
+         if( read_bytes( scan_snapshot_magic.size() ) != scan_snapshot_magic ) {
+            FILEZ_ERROR( "file " << m_path << " is not a scan snapshot" );
+         }
+         scan_snapshot result;
+         const std::size_t roots = read_word();
+         const bool config = ( read_bytes( read_word() ) == smart_hash_config() );
+
+         for( std::size_t i = 0; i < roots; ++i ) {
+            result.roots.emplace_back( read_bytes( read_word() ) );
+            file_info_vector& list = result.lists.emplace_back();
+            const std::size_t entries = read_word();
+
+            for( std::size_t j = 0; j < entries; ++j ) {
+               list.emplace_back( read_entry( config ) );
+            }
+         }
+         return result;
+      }
+
+   private:
+      const std::filesystem::path m_path;
+      const file_mmap m_mmap;
+      std::size_t m_offset = 0;
+
+      [[nodiscard]] std::uint64_t read_word()
+      {
+         std::uint64_t word;
+         std::memcpy( &word, read_bytes( sizeof( word ) ).data(), sizeof( word ) );
+         return word;
+      }
+
+      [[nodiscard]] std::string_view read_bytes( const std::size_t size )
+      {
+         const std::size_t padded = size + ( 8 - size % 8 ) % 8;
+
+         if( ( padded < size ) || ( padded > m_mmap.size() - m_offset ) ) {
+            FILEZ_ERROR( "truncated scan snapshot " << m_path );
+         }
+         const std::string_view result( m_mmap.data() + m_offset, size );
+         m_offset += padded;
+         return result;
+      }
+
+      [[nodiscard]] std::shared_ptr< file_info > read_entry( const bool config )
+      {
+         const std::size_t size = read_word();
+         const file_time mtime = read_word();
+         const ::dev_t device = read_word();
+         const ::ino_t inode = read_word();
+         const std::uint64_t type_links = read_word();
+         const std::uint64_t lengths = read_word();
+
+         const std::string_view path = read_bytes( lengths >> 32 );
+         std::string smart( read_bytes( ( lengths >> 16 ) & 0xffff ) );
+         std::string total( read_bytes( lengths & 0xffff ) );
+
+         if( !( config && ( ( smart == "E" ) || is_current_hash( smart, smart_hash_scopes() ) ) ) ) {
+            smart.clear();
+         }
+         if( !( ( total == "E" ) || is_current_hash( total, "T" ) ) ) {
+            total.clear();
+         }
+         const file_stat stat( ::mode_t( type_links >> 32 ), size, std::size_t( type_links & 0xffffffff ), file_node( device, inode ), mtime );
+         return std::make_shared< file_info >( std::filesystem::path( path ), stat, std::move( smart ), std::move( total ) );
+      }
+   };
+
+   inline void save_scan_snapshot( const std::filesystem::path& path, const scan_snapshot& snapshot )
+   {
+      scan_snapshot_writer( path ).write( snapshot );
+   }
+
+   [[nodiscard]] inline scan_snapshot load_scan_snapshot( const std::filesystem::path& path )
+   {
+      return scan_snapshot_reader( path ).read();
+   }
+
+}  // namespace filez
@@ -0,0 +1,287 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <queue>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "file_filter.hpp"
+#include "file_info.hpp"
+#include "file_info_vector.hpp"
+#include "file_stat.hpp"
+#include "macros.hpp"
+
+namespace filez
+{
+   // External memory alternative to keeping all files in memory for the modes that group
+   // by size first. The (size, path) records of all regular files are collected in a buffer
+   // that, whenever it exceeds half the memory limit, is sorted by size and written to a
+   // temporary file as a run. The runs are then combined with a k-way merge and handed
+   // out in batches of complete size groups in the order of increasing size, again of
+   // about half the memory limit, and only for sizes that occur at least twice.
+
+   class size_spill
+   {
+   public:
+      size_spill( const std::size_t limit, size_scan_stats& stats )
+         : m_limit( std::max< std::size_t >( limit / 2, 1 ) ),
+           m_stats( stats )
+      {}
+
+      size_spill( size_spill&& ) = delete;
+      size_spill( const size_spill& ) = delete;
+
+      void operator=( size_spill&& ) = delete;
+      void operator=( const size_spill& ) = delete;
+
+      void add( const std::filesystem::path& path, const std::size_t size )
+      {
+         m_bytes += record_bytes( m_buffer.emplace_back( size, m_records++, path.native() ) );
+         ++m_stats.files;
+
+         if( m_bytes > m_limit ) {
+            spill();
+         }
+      }
+
+      // Calls f( file_info_vector&& ) for batches of files; all files with the same size are
+      // in the same batch, and the files with the same size are in the order they were added.
+
+      template< typename F >
+      void merge( F&& f )
+      {
+         file_info_vector batch;
+         std::size_t batch_bytes = 0;
+         std::vector< record > group;
+
+         const auto flush_group = [ & ](){
+            if( group.size() < 2 ) {
+               m_stats.skipped += group.size();
+            }
+            else {
+               for( auto& r : group ) {
+                  batch_bytes += record_bytes( r ) + sizeof( file_info ) + 128;
+                  batch.emplace_back( std::make_shared< file_info >( std::filesystem::path( std::move( r.path ) ) ) );
+               }
+            }
+            group.clear();
+
+            if( batch_bytes > m_limit ) {
+               f( std::move( batch ) );
+               batch.clear();
+               batch_bytes = 0;
+            }
+         };
+         for_each_record( [ & ]( record&& r ){
+            if( ( !group.empty() ) && ( group.front().size != r.size ) ) {
+               flush_group();
+            }
+            group.emplace_back( std::move( r ) );
+         } );
+         flush_group();
+
+         if( !batch.empty() ) {
+            f( std::move( batch ) );
+         }
+      }
+
+   private:
+      struct record
+      {
+         record() = default;
+
+         record( const std::size_t s, const std::size_t q, const std::string& p )
+            : size( s ),
+              seq( q ),
+              path( p )
+         {}
+
+         std::size_t size = 0;
+         std::size_t seq = 0;  // The order in which the records were added, to keep that order within a size.
+         std::string path;
+
+         [[nodiscard]] auto key() const noexcept
+         {
+            return std::tie( size, seq );
+         }
+      };
+
+      struct file_closer
+      {
+         void operator()( std::FILE* file ) const noexcept
+         {
+            (void)std::fclose( file );
+         }
+      };
+
+      using file_ptr = std::unique_ptr< std::FILE, file_closer >;
+
+      const std::size_t m_limit;
+      size_scan_stats& m_stats;
+
+      std::size_t m_bytes = 0;
+      std::size_t m_records = 0;
+      std::vector< record > m_buffer;
+      std::vector< file_ptr > m_runs;
+
+      [[nodiscard]] static std::size_t record_bytes( const record& r ) noexcept
+      {
+         return sizeof( record ) + r.path.capacity();
+      }
+
+      static void write_word( std::FILE* file, const std::uint64_t word )
+      {
+         if( std::fwrite( &word, sizeof( word ), 1, file ) != 1 ) {
+            FILEZ_ERRNO( "unable to write temporary file" );
+         }
+      }
+
+      [[nodiscard]] static bool read_word( std::FILE* file, std::uint64_t& word )
+      {
+         if( std::fread( &word, sizeof( word ), 1, file ) == 1 ) {
+            return true;
+         }
+         if( std::ferror( file ) ) {
+            FILEZ_ERRNO( "unable to read temporary file" );
+         }
+         return false;
+      }
+
+      static void write_record( std::FILE* file, const record& r )
+      {
+         write_word( file, r.size );
+         write_word( file, r.seq );
+         write_word( file, r.path.size() );
+
+         if( std::fwrite( r.path.data(), 1, r.path.size(), file ) != r.path.size() ) {
+            FILEZ_ERRNO( "unable to write temporary file" );
+         }
+      }
+
+      [[nodiscard]] static bool read_record( std::FILE* file, record& r )
+      {
+         std::uint64_t size;
+         std::uint64_t seq;
+         std::uint64_t length;
+
+         if( !read_word( file, size ) ) {
+            return false;
+         }
+         if( ( !read_word( file, seq ) ) || ( !read_word( file, length ) ) ) {
+            FILEZ_ERROR( "truncated temporary file" );
+         }
+         r.size = std::size_t( size );
+         r.seq = std::size_t( seq );
+         r.path.resize( std::size_t( length ) );
+
+         if( std::fread( r.path.data(), 1, r.path.size(), file ) != r.path.size() ) {
+            FILEZ_ERROR( "truncated temporary file" );
+         }
+         return true;
+      }
+
+      void sort_buffer()
+      {
+         std::sort( m_buffer.begin(), m_buffer.end(), []( const record& l, const record& r ){ return l.key() < r.key(); } );
+      }
+
+      void spill()
+      {
+         file_ptr file( std::tmpfile() );
+
+         if( !file ) {
+            FILEZ_ERRNO( "unable to create temporary file" );
+         }
+         sort_buffer();
+
+         for( const auto& r : m_buffer ) {
+            write_record( file.get(), r );
+         }
+         if( std::fflush( file.get() ) != 0 ) {
+            FILEZ_ERRNO( "unable to write temporary file" );
+         }
+         m_runs.emplace_back( std::move( file ) );
+         m_buffer.clear();
+         m_buffer.shrink_to_fit();
+         m_bytes = 0;
+      }
+
+      template< typename F >
+      void for_each_record( F&& f )
+      {
+         if( m_runs.empty() ) {
+            sort_buffer();
+
+            for( auto& r : m_buffer ) {
+               f( std::move( r ) );
+            }
+            m_buffer.clear();
+            return;
+         }
+         if( !m_buffer.empty() ) {
+            spill();
+         }
+         std::vector< record > heads( m_runs.size() );
+
+         const auto greater = [ & ]( const std::size_t l, const std::size_t r ){ return heads[ r ].key() < heads[ l ].key(); };
+         std::priority_queue< std::size_t, std::vector< std::size_t >, decltype( greater ) > queue( greater );
+
+         for( std::size_t i = 0; i < m_runs.size(); ++i ) {
+            std::rewind( m_runs[ i ].get() );
+
+            if( read_record( m_runs[ i ].get(), heads[ i ] ) ) {
+               queue.push( i );
+            }
+         }
+         while( !queue.empty() ) {
+            const std::size_t i = queue.top();
+            queue.pop();
+            f( std::move( heads[ i ] ) );
+
+            if( read_record( m_runs[ i ].get(), heads[ i ] ) ) {
+               queue.push( i );
+            }
+         }
+         m_runs.clear();
+      }
+   };
+
+   // Adds all regular files found under the paths to the spill.
+
+   template< typename I >
+   void spill_file_sizes_impl( const std::filesystem::path& path, size_spill& spill )
+   {
+      const file_filter& filter = global_file_filter();
+
+      filtered_walk< I >( path, [ & ]( const std::filesystem::directory_entry& de ){
+         if( de.is_symlink() || ( !de.is_regular_file() ) ) {
+            return;  // The directory entry usually knows the type without a stat() call.
+         }
+         if( const file_stat st( de.path(), stat_size | filter.fields() ); st.is_file() && filter.selects( de.path(), st ) ) {
+            spill.add( de.path(), st.size() );
+         }
+      } );
+   }
+
+   inline void spill_file_sizes( const std::vector< std::filesystem::path >& paths, const bool recursive, size_spill& spill )
+   {
+      for( const auto& path : paths ) {
+         if( recursive ) {
+            spill_file_sizes_impl< std::filesystem::recursive_directory_iterator >( path, spill );
+         }
+         else {
+            spill_file_sizes_impl< std::filesystem::directory_iterator >( path, spill );
+         }
+      }
+   }
+
+}  // namespace filez
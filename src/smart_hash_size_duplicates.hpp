@@ -2,11 +2,8 @@
 
 #pragma once
 
-#include <map>
-#include <memory>
-#include <vector>
-
 #include "file_info_vector.hpp"
+#include "group_pipeline.hpp"
 #include "macros.hpp"
 
 namespace filez
@@ -18,39 +15,22 @@ namespace filez
 
       void add( const file_info_vector& list )
       {
-         for( const auto& sp : list ) {
-            if( sp->stat().is_file() ) {
-               m_map.try_emplace( sp->stat().size() ).first->second.emplace_back( sp );
-            }
-         }
+         m_pipeline.add( list );
       }
 
       void work()
       {
-         for( const auto& kv : m_map ) {
-            FILEZ_ASSERT( !kv.second.empty() );
-
-            if( kv.second.size() > 1 ) {
-               std::map< std::string, std::vector< std::shared_ptr< file_info > > > map;
-
-               for( const auto& fi : kv.second ) {
-                  map.try_emplace( fi->smart_hash() ).first->second.emplace_back( fi );
-               }
-               for( const auto& sv : map ) {
-                  if( sv.second.size() > 1 ) {
-                     FILEZ_STDOUT( sv.second.size() << " duplicates with same size " << kv.first << " and same smart hash" );
-
-                     for( const auto& fi : sv.second ) {
-                        FILEZ_STDOUT( "   " << fi->path() );
-                     }
-                  }
-               }
+         for( const auto& group : m_pipeline.groups() ) {
+            FILEZ_STDOUT( group.size() << " duplicates with same size " << group.front()->stat().size() << " and same smart hash" );
+
+            for( const auto& fi : group ) {
+               FILEZ_STDOUT( "   " << fi->path() );
             }
          }
       }
 
    private:
-      std::map< std::size_t, std::vector< std::shared_ptr< file_info > > > m_map;
+      group_pipeline< size_key, smart_hash_key > m_pipeline;
    };
 
 }  // namespace filez
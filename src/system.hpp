@@ -7,6 +7,8 @@
 #include <cstdlib>
 #include <unistd.h>
 
+#include <sys/resource.h>
+
 namespace filez
 {
    [[nodiscard]] inline std::size_t get_pagesize_raw()
@@ -39,4 +41,18 @@ namespace filez
       return size & ( -page );
    }
 
+   [[nodiscard]] inline std::size_t peak_memory_usage()
+   {
+      struct ::rusage usage;
+
+      if( ::getrusage( RUSAGE_SELF, &usage ) != 0 ) {
+         return 0;
+      }
+#if defined( __APPLE__ )
+      return std::size_t( usage.ru_maxrss );  // Bytes on macOS.
+#else
+      return std::size_t( usage.ru_maxrss ) * 1024;  // Kilobytes on Linux.
+#endif
+   }
+
 }  // namespace filez
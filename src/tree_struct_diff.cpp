@@ -1,9 +1,14 @@
 // Copyright (c) 2022-2025 Dr. Colin Hirsch - All Rights Reserved
 
 #include <filesystem>
+#include <string>
+#include <vector>
 
 #include "arguments.hpp"
+#include "file_filter.hpp"
+#include "file_info_vector.hpp"
 #include "macros.hpp"
+#include "scan_snapshot.hpp"
 #include "tree_struct_diff.hpp"
 
 bool canonical = true;
@@ -11,6 +16,9 @@ bool canonical = true;
 bool check_sizes = false;
 bool check_types = false;
 
+std::string save_scan;
+std::string load_scan;
+
 std::vector< std::filesystem::path > paths;
 
 int main( int argc, char** argv )
@@ -20,23 +28,62 @@ int main( int argc, char** argv )
    args.add_bool( 'C', canonical );
    args.add_bool( 's', check_sizes );
    args.add_bool( 't', check_types );
+   args.add_bool( "dont-sync", filez::global_stat_args().dont_sync );
+   args.add_strings( "exclude", filez::global_filter_args().exclude );
+   args.add_strings( "exclude-regex", filez::global_filter_args().exclude_regex );
+   args.add_string( "save-scan", save_scan );
+   args.add_string( "load-scan", load_scan );
 
-   if( ( !args.parse_nothrow( argc, argv ) ) || ( paths.size() != 2 ) ) {
+   if( ( !args.parse_nothrow( argc, argv ) ) || ( ( paths.size() != 2 ) && ( load_scan.empty() || ( !paths.empty() ) ) ) || ( ( !save_scan.empty() ) && ( !load_scan.empty() ) ) ) {
       FILEZ_STDERR( "Usage: " << argv[ 0 ] << " [OPTION]... DIRECTORY DIRECTORY" );
+      FILEZ_STDERR( "   or: " << argv[ 0 ] << " [OPTION]... --load-scan FILE [DIRECTORY DIRECTORY]" );
       FILEZ_STDERR( "  Compares the structure of two directory trees comparing" );
       FILEZ_STDERR( "  the file names present or absent in each (sub-)directory." );
       FILEZ_STDERR( "  Options are..." );
       FILEZ_STDERR( "    -C   to disable normalising the given paths." );
       FILEZ_STDERR( "    -s   to also check file sizes for differences." );
       FILEZ_STDERR( "    -t   to also check file types for differences." );
+      FILEZ_STDERR( "    --dont-sync          to accept cached file attributes on network filesystems." );
+      FILEZ_STDERR( "    --exclude GLOB       to skip entries whose name matches GLOB, or whose path when" );
+      FILEZ_STDERR( "                         GLOB contains a '/', without descending into directories." );
+      FILEZ_STDERR( "    --exclude-regex RE   to skip entries whose path contains a match for RE." );
+      FILEZ_STDERR( "    --save-scan FILE     to scan both trees once and save the scan to FILE." );
+      FILEZ_STDERR( "    --load-scan FILE     to compare two trees of a saved scan instead of the filesystem," );
+      FILEZ_STDERR( "                         by default the two directories given when it was saved." );
       FILEZ_STDERR( "  File types are 'directory', 'file', etc." );
       return 1;
    }
+   if( !load_scan.empty() ) {
+      const filez::scan_snapshot snapshot = filez::load_scan_snapshot( load_scan );
+
+      if( paths.empty() ) {
+         if( snapshot.roots.size() != 2 ) {
+            FILEZ_STDERR( "Scan " << load_scan << " does not contain two directories." );
+            return 1;
+         }
+         paths = snapshot.roots;
+      }
+      for( auto& path : paths ) {
+         path = std::filesystem::absolute( path ).lexically_normal();  // The filesystem is not consulted.
+
+         if( !path.has_filename() ) {
+            path = path.parent_path();
+         }
+      }
+      filez::tree_struct_diff( filez::snapshot_tree( snapshot ), paths[ 0 ], paths[ 1 ], check_sizes, check_types );
+      return 0;
+   }
    for( auto& path : paths ) {
       if( canonical ) {
          path = std::filesystem::canonical( path );
       }
    }
+   if( !save_scan.empty() ) {
+      const filez::scan_snapshot snapshot = { paths, { filez::make_full_file_info_vector( paths[ 0 ] ), filez::make_full_file_info_vector( paths[ 1 ] ) } };
+      filez::save_scan_snapshot( save_scan, snapshot );
+      filez::tree_struct_diff( filez::snapshot_tree( snapshot ), paths[ 0 ], paths[ 1 ], check_sizes, check_types );
+      return 0;
+   }
    filez::tree_struct_diff( paths[ 0 ], paths[ 1 ], check_sizes, check_types );
    return 0;
 }
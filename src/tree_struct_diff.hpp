@@ -3,18 +3,78 @@
 #pragma once
 
 #include <filesystem>
+#include <map>
 
 #include "file_path_set.hpp"
 #include "file_stat.hpp"
 #include "macros.hpp"
+#include "scan_snapshot.hpp"
 #include "utility.hpp"
 
 namespace filez
 {
-   inline void tree_struct_diff( const std::filesystem::path& left_path, const std::filesystem::path& right_path, const bool check_sizes, const bool check_types )
+   // The directory trees compared by tree_struct_diff() are either read from the filesystem
+   // or taken from a scan snapshot, see scan_snapshot.hpp.
+
+   struct filesystem_tree
+   {
+      [[nodiscard]] file_path_set children( const std::filesystem::path& path ) const
+      {
+         return make_file_path_set( path );
+      }
+
+      [[nodiscard]] file_stat stat( const std::filesystem::path& path, const stat_fields fields ) const
+      {
+         return file_stat( path, fields );
+      }
+   };
+
+   class snapshot_tree
    {
-      const file_path_set left_set = make_file_path_set( left_path );
-      const file_path_set right_set = make_file_path_set( right_path );
+   public:
+      explicit snapshot_tree( const scan_snapshot& snapshot )
+      {
+         for( const auto& list : snapshot.lists ) {
+            for( const auto& fi : list ) {
+               m_stats.try_emplace( fi->path(), fi->stat() );
+               m_children[ fi->path().parent_path() ].emplace( fi->path() );
+            }
+         }
+      }
+
+      snapshot_tree( snapshot_tree&& ) = delete;
+      snapshot_tree( const snapshot_tree& ) = delete;
+
+      void operator=( snapshot_tree&& ) = delete;
+      void operator=( const snapshot_tree& ) = delete;
+
+      [[nodiscard]] const file_path_set& children( const std::filesystem::path& path ) const
+      {
+         static const file_path_set empty;
+         const auto iter = m_children.find( path );
+         return ( iter == m_children.end() ) ? empty : iter->second;
+      }
+
+      [[nodiscard]] const file_stat& stat( const std::filesystem::path& path, const stat_fields /*unused*/ ) const
+      {
+         const auto iter = m_stats.find( path );
+
+         if( iter == m_stats.end() ) {
+            FILEZ_ERROR( "path " << path << " is not in the scan snapshot" );
+         }
+         return iter->second;
+      }
+
+   private:
+      std::map< std::filesystem::path, file_stat > m_stats;
+      std::map< std::filesystem::path, file_path_set > m_children;
+   };
+
+   template< typename T >
+   void tree_struct_diff( const T& tree, const std::filesystem::path& left_path, const std::filesystem::path& right_path, const bool check_sizes, const bool check_types )
+   {
+      const auto& left_set = tree.children( left_path );
+      const auto& right_set = tree.children( right_path );
 
       // if( check_sizes && ( left_set.size() != right_set.size() ) ) {
       //    FILEZ_STDOUT( "Directory size  mismatch: " << left_set.size() << " and " << right_set.size() );
@@ -26,11 +86,11 @@ namespace filez
          const auto left_name = left_iter->filename();
          const auto right_name = right_iter->filename();
 
-         if( ignore( left_name ) ) {
+         if( ignore( *left_iter ) ) {
             ++left_iter;
             continue;
          }
-         if( ignore( right_name ) ) {
+         if( ignore( *right_iter ) ) {
             ++right_iter;
             continue;
          }
@@ -44,8 +104,9 @@ namespace filez
             ++right_iter;
             continue;
          }
-         const file_stat left_stat( *left_iter );
-         const file_stat right_stat( *right_iter );
+         const stat_fields fields = check_sizes ? stat_size : stat_type;
+         const auto& left_stat = tree.stat( *left_iter, fields );
+         const auto& right_stat = tree.stat( *right_iter, fields );
 
          if( check_types && ( left_stat.type() != right_stat.type() ) ) {
             FILEZ_STDOUT( "Type mismatch: " << *left_iter << " and " << *right_iter );
@@ -56,19 +117,28 @@ namespace filez
             }
          }
          else if( left_stat.is_dir() ) {
-            tree_struct_diff( *left_iter, *right_iter, check_sizes, check_types );
+            tree_struct_diff( tree, *left_iter, *right_iter, check_sizes, check_types );
          }
          ++left_iter;
          ++right_iter;
       }
       while( left_iter != left_set.end() ) {
-         FILEZ_STDOUT( " - " << *left_iter );
+         if( !ignore( *left_iter ) ) {
+            FILEZ_STDOUT( " - " << *left_iter );
+         }
          ++left_iter;
       }
       while( right_iter != right_set.end() ) {
-         FILEZ_STDOUT( " + " << *right_iter );
+         if( !ignore( *right_iter ) ) {
+            FILEZ_STDOUT( " + " << *right_iter );
+         }
          ++right_iter;
       }
    }
 
+   inline void tree_struct_diff( const std::filesystem::path& left_path, const std::filesystem::path& right_path, const bool check_sizes, const bool check_types )
+   {
+      tree_struct_diff( filesystem_tree(), left_path, right_path, check_sizes, check_types );
+   }
+
 }  // namespace filez
@@ -5,18 +5,20 @@
 #include <algorithm>
 #include <filesystem>
 
+#include "file_filter.hpp"
 #include "macros.hpp"
 
 namespace filez
 {
-   [[nodiscard]] inline bool ignore( const std::filesystem::path& path ) noexcept
+   // Whether a directory entry is skipped, the configuration point is the global file filter.
+
+   [[nodiscard]] inline bool ignore( const std::filesystem::path& path )
    {
       if( path.empty() ) {
          return true;
       }
       const auto& n = path.native();
-      // TODO: Extension/configuration point.
-      return ( n == "." ) || ( n == ".." );
+      return ( n == "." ) || ( n == ".." ) || global_file_filter().excludes( path );
    }
 
    [[nodiscard]] inline std::size_t components( const std::filesystem::path& path ) noexcept
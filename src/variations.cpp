@@ -1,11 +1,18 @@
 // Copyright (c) 2022-2025 Dr. Colin Hirsch - All Rights Reserved
 
 #include <filesystem>
+#include <string>
 #include <vector>
 
 #include "arguments.hpp"
+#include "directory_scan.hpp"
+#include "file_filter.hpp"
 #include "file_info_vector.hpp"
+#include "hash_args.hpp"
 #include "macros.hpp"
+#include "root_scan.hpp"
+#include "scan_snapshot.hpp"
+#include "size_spill.hpp"
 
 #include "find_variations.hpp"
 #include "name_size_variations.hpp"
@@ -19,6 +26,11 @@
 
 bool canonical = true;
 bool recursive = true;
+bool inode_order = false;
+bool size_mode = false;  // Whether the mode only considers files with the same size.
+std::size_t memory_limit = 0;
+std::string save_scan;
+std::string load_scan;
 
 std::vector< std::filesystem::path > paths;
 
@@ -31,20 +43,30 @@ int main( int argc, char** argv )
    args.add_bool( 'C', canonical );
    args.add_bool( 'R', recursive );
 
-   args.add_bool( 's', []( const std::string_view ){ finder = std::make_shared< filez::find_variations< filez::name_size_variations > >(); } );
-   args.add_bool( 'i', []( const std::string_view ){ finder = std::make_shared< filez::find_variations< filez::node_name_variations > >(); } );
+   args.add_bool( 's', []( const std::string_view ){ size_mode = false; finder = std::make_shared< filez::find_variations< filez::name_size_variations > >(); } );
+   args.add_bool( 'i', []( const std::string_view ){ size_mode = false; finder = std::make_shared< filez::find_variations< filez::node_name_variations > >(); } );
 
-   args.add_bool( 'n', []( const std::string_view ){ /* finder = std::make_shared< filez::find_variations< filez::name_smart_hash_variations > >(); */ } );
-   args.add_bool( 'N', []( const std::string_view ){ finder = std::make_shared< filez::find_variations< filez::name_total_hash_variations > >(); } );
+   args.add_bool( 'n', []( const std::string_view ){ size_mode = false; /* finder = std::make_shared< filez::find_variations< filez::name_smart_hash_variations > >(); */ } );
+   args.add_bool( 'N', []( const std::string_view ){ size_mode = false; finder = std::make_shared< filez::find_variations< filez::name_total_hash_variations > >(); } );
 
-   args.add_bool( 'h', []( const std::string_view ){ finder = std::make_shared< filez::find_variations< filez::smart_hash_name_variations > >(); } );
-   args.add_bool( 'H', []( const std::string_view ){ finder = std::make_shared< filez::find_variations< filez::total_hash_node_variations > >(); } );
+   args.add_bool( 'h', []( const std::string_view ){ size_mode = true; finder = std::make_shared< filez::find_variations< filez::smart_hash_name_variations > >(); } );
+   args.add_bool( 'H', []( const std::string_view ){ size_mode = true; finder = std::make_shared< filez::find_variations< filez::total_hash_node_variations > >(); } );
 
-   args.add_bool( 'x', []( const std::string_view ){ finder = std::make_shared< filez::find_variations< filez::smart_hash_node_variations > >(); } );
-   args.add_bool( 'X', []( const std::string_view ){ finder = std::make_shared< filez::find_variations< filez::total_hash_name_variations > >(); } );
+   args.add_bool( 'x', []( const std::string_view ){ size_mode = true; finder = std::make_shared< filez::find_variations< filez::smart_hash_node_variations > >(); } );
+   args.add_bool( 'X', []( const std::string_view ){ size_mode = true; finder = std::make_shared< filez::find_variations< filez::total_hash_name_variations > >(); } );
 
-   if( ( !args.parse_nothrow( argc, argv ) ) || paths.empty() ) {
+   args.add_size( "memory-limit", memory_limit );
+   args.add_bool( "dont-sync", filez::global_stat_args().dont_sync );
+   args.add_bool( "inode-order", inode_order );
+   args.add_string( "save-scan", save_scan );
+   args.add_string( "load-scan", load_scan );
+
+   filez::add_filter_args( args );
+   filez::add_hash_args( args );
+
+   if( ( !args.parse_nothrow( argc, argv ) ) || ( paths.empty() == load_scan.empty() ) ) {
       FILEZ_STDERR( "Usage: " << argv[ 0 ] << " [OPTION]... DIRECTORY [DIRECTORY]..." );
+      FILEZ_STDERR( "   or: " << argv[ 0 ] << " [OPTION]... --load-scan FILE" );
       FILEZ_STDERR( "  Finds file meta data variations in one or more directories." );
       FILEZ_STDERR( "    -s   Finds variations of file size for the same file name." );
       FILEZ_STDERR( "    -i   Finds variations of file name for the same device and inode." );
@@ -57,9 +79,19 @@ int main( int argc, char** argv )
       FILEZ_STDERR( "  Additional options are..." );
       FILEZ_STDERR( "    -R   to change to non-recursive scanning." );
       FILEZ_STDERR( "    -C   to disable normalising the given paths." );
+      FILEZ_STDERR( "    --memory-limit N to keep at most about N MiB of file records in memory" );
+      FILEZ_STDERR( "                     and use temporary files for the rest, for -h, -H, -x and -X." );
+      FILEZ_STDERR( "    --dont-sync      to accept cached file attributes on network filesystems." );
+      FILEZ_STDERR( "    --inode-order    to stat the entries of every directory in inode order." );
+      FILEZ_STDERR( "    --save-scan FILE to save the scanned entries and the calculated hashes." );
+      FILEZ_STDERR( "    --load-scan FILE to use the saved entries and hashes instead of scanning" );
+      FILEZ_STDERR( "                     the directories again, e.g. to try another mode." );
+      filez::print_filter_args_usage();
+      filez::print_hash_args_usage();
       FILEZ_STDERR( "  The smart hash only hashes two or three small chunks" );
-      FILEZ_STDERR( "    when the file is large and the extension is one for" );
-      FILEZ_STDERR( "    which a partial hash is usually sufficient." );
+      FILEZ_STDERR( "    when the file is large and its format, recognised from the" );
+      FILEZ_STDERR( "    first bytes or the extension, is one for which a partial" );
+      FILEZ_STDERR( "    hash is usually sufficient." );
       FILEZ_STDERR( "  The details are in hash_file.hpp and hash_size.hpp." );
       return 1;
    }
@@ -67,8 +99,58 @@ int main( int argc, char** argv )
       if( canonical ) {
          path = std::filesystem::canonical( path );
       }
-      finder->add( recursive ? filez::make_full_file_info_vector( path ) : filez::make_file_info_vector( path ) );
    }
-   finder->work();
+   if( inode_order && ( memory_limit > 0 ) && size_mode ) {
+      FILEZ_STDERR( "Option --inode-order can not be combined with --memory-limit." );
+      return 1;
+   }
+   if( ( !save_scan.empty() || !load_scan.empty() ) && ( memory_limit > 0 ) ) {
+      FILEZ_STDERR( "Options --save-scan and --load-scan can not be combined with --memory-limit." );
+      return 1;
+   }
+   if( ( memory_limit > 0 ) && size_mode ) {
+      // The output is ordered by size first, so the size groups can be processed one batch at a time.
+      filez::size_scan_stats stats;
+      filez::size_spill spill( memory_limit * 1024 * 1024, stats );
+      filez::spill_file_sizes( paths, recursive, spill );
+      spill.merge( []( filez::file_info_vector&& batch ){
+         finder->add( batch );
+         finder->work();
+      } );
+      filez::print_size_scan_stats( stats );
+   }
+   else {
+      filez::scan_snapshot snapshot;
+
+      if( !load_scan.empty() ) {
+         snapshot = filez::load_scan_snapshot( load_scan );
+      }
+      else {
+         snapshot.roots = paths;
+         snapshot.lists.resize( paths.size() );
+
+         filez::for_each_root_concurrently( paths, [ & ]( const std::size_t i ){
+            if( inode_order ) {
+               snapshot.lists[ i ] = filez::make_inode_ordered_file_info_vector( paths[ i ], recursive );
+            }
+            else {
+               snapshot.lists[ i ] = recursive ? filez::make_full_file_info_vector( paths[ i ] ) : filez::make_file_info_vector( paths[ i ] );
+            }
+         } );
+      }
+      for( const auto& list : snapshot.lists ) {
+         finder->add( list );
+      }
+      if( save_scan.empty() ) {
+         snapshot.lists.clear();  // The finder holds its own references to the files.
+      }
+      finder->work();
+
+      if( !save_scan.empty() ) {
+         // Saved after the work to include the hashes that it calculated.
+         filez::save_scan_snapshot( save_scan, snapshot );
+      }
+   }
+   filez::print_hash_statistics();
    return 0;
 }
@@ -0,0 +1,48 @@
+// Copyright (c) 2025 Dr. Colin Hirsch - All Rights Reserved
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace filez
+{
+   constexpr std::size_t xxh3_hash_size = 128 / 8;
+   constexpr std::size_t xxh3_stripe_size = 64;
+   constexpr std::size_t xxh3_buffer_size = 256;
+
+   // Portable (no SIMD) streaming implementation of the 128-bit XXH3 hash with the default
+   // secret and seed 0; this is NOT a cryptographic hash, it is only intended to be fast.
+
+   class xxh3
+   {
+   public:
+      xxh3() noexcept;
+
+      void update( const void* data, const std::size_t size )
+      {
+         updatev( static_cast< const std::uint8_t* >( data ), size );
+      }
+
+      void finalise( void* hash )
+      {
+         // hash MUST point to xxh3_hash_size writable bytes!
+
+         finalisev( static_cast< std::uint8_t* >( hash ) );
+      }
+
+   private:
+      std::uint64_t m_acc[ 8 ];
+      std::uint64_t m_length = 0;
+      std::size_t m_stripes = 0;  // Stripes consumed in the current block.
+      std::size_t m_buffered = 0;
+      std::uint8_t m_buffer[ xxh3_buffer_size ];
+
+      void consume( const std::uint8_t*, std::size_t );
+      void updatev( const std::uint8_t*, std::size_t );
+      void finalisev( std::uint8_t* );
+   };
+
+}  // namespace filez
+
+#include "xxh3_impl.hpp"
@@ -0,0 +1,322 @@
+//  Implementation of the 128-bit XXH3 hash function.
+//  Follows the xxHash specification and reference implementation by Yann Collet (BSD 2-Clause).
+//  Adapted to C++ by Dr. Colin Hirsch.
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#include "macros.hpp"
+
+namespace filez
+{
+   constexpr std::uint8_t xxh3_secret_impl[ 192 ] = {
+      0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+      0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+      0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+      0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+      0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+      0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+      0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+      0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+      0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+      0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+      0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+      0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e
+   };
+
+   constexpr std::size_t xxh3_secret_size = sizeof( xxh3_secret_impl );
+   constexpr std::size_t xxh3_stripes_per_block = ( xxh3_secret_size - xxh3_stripe_size ) / 8;
+
+   constexpr std::uint32_t xxh3_prime32_1 = 0x9E3779B1U;
+   constexpr std::uint32_t xxh3_prime32_2 = 0x85EBCA77U;
+   constexpr std::uint32_t xxh3_prime32_3 = 0xC2B2AE3DU;
+
+   constexpr std::uint64_t xxh3_prime64_1 = 0x9E3779B185EBCA87ULL;
+   constexpr std::uint64_t xxh3_prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+   constexpr std::uint64_t xxh3_prime64_3 = 0x165667B19E3779F9ULL;
+   constexpr std::uint64_t xxh3_prime64_4 = 0x85EBCA77C2B2AE63ULL;
+   constexpr std::uint64_t xxh3_prime64_5 = 0x27D4EB2F165667C5ULL;
+
+   constexpr std::uint64_t xxh3_prime_mx1 = 0x165667919E3779F9ULL;
+   constexpr std::uint64_t xxh3_prime_mx2 = 0x9FB21C651E98DF25ULL;
+
+   struct xxh3_128_impl
+   {
+      std::uint64_t low;
+      std::uint64_t high;
+   };
+
+   [[nodiscard]] inline std::uint32_t xxh3_read32_impl( const std::uint8_t* p ) noexcept
+   {
+      return std::uint32_t( p[ 0 ] ) | ( std::uint32_t( p[ 1 ] ) << 8 ) | ( std::uint32_t( p[ 2 ] ) << 16 ) | ( std::uint32_t( p[ 3 ] ) << 24 );
+   }
+
+   [[nodiscard]] inline std::uint64_t xxh3_read64_impl( const std::uint8_t* p ) noexcept
+   {
+      return std::uint64_t( xxh3_read32_impl( p ) ) | ( std::uint64_t( xxh3_read32_impl( p + 4 ) ) << 32 );
+   }
+
+   [[nodiscard]] constexpr std::uint32_t xxh3_swap32_impl( const std::uint32_t x ) noexcept
+   {
+      return ( ( x << 24 ) & 0xff000000U ) | ( ( x << 8 ) & 0x00ff0000U ) | ( ( x >> 8 ) & 0x0000ff00U ) | ( ( x >> 24 ) & 0x000000ffU );
+   }
+
+   [[nodiscard]] constexpr std::uint64_t xxh3_swap64_impl( const std::uint64_t x ) noexcept
+   {
+      return ( std::uint64_t( xxh3_swap32_impl( std::uint32_t( x ) ) ) << 32 ) | xxh3_swap32_impl( std::uint32_t( x >> 32 ) );
+   }
+
+   [[nodiscard]] constexpr xxh3_128_impl xxh3_mul128_impl( const std::uint64_t a, const std::uint64_t b ) noexcept
+   {
+      const __uint128_t p = __uint128_t( a ) * b;
+      return { std::uint64_t( p ), std::uint64_t( p >> 64 ) };
+   }
+
+   [[nodiscard]] constexpr std::uint64_t xxh3_fold64_impl( const std::uint64_t a, const std::uint64_t b ) noexcept
+   {
+      const xxh3_128_impl p = xxh3_mul128_impl( a, b );
+      return p.low ^ p.high;
+   }
+
+   [[nodiscard]] constexpr std::uint64_t xxh3_xxh64_avalanche_impl( std::uint64_t h ) noexcept
+   {
+      h ^= h >> 33;
+      h *= xxh3_prime64_2;
+      h ^= h >> 29;
+      h *= xxh3_prime64_3;
+      h ^= h >> 32;
+      return h;
+   }
+
+   [[nodiscard]] constexpr std::uint64_t xxh3_avalanche_impl( std::uint64_t h ) noexcept
+   {
+      h ^= h >> 37;
+      h *= xxh3_prime_mx1;
+      h ^= h >> 32;
+      return h;
+   }
+
+   [[nodiscard]] inline std::uint64_t xxh3_mix16_impl( const std::uint8_t* in, const std::uint8_t* secret ) noexcept
+   {
+      return xxh3_fold64_impl( xxh3_read64_impl( in ) ^ xxh3_read64_impl( secret ), xxh3_read64_impl( in + 8 ) ^ xxh3_read64_impl( secret + 8 ) );
+   }
+
+   inline void xxh3_mix32_impl( xxh3_128_impl& acc, const std::uint8_t* in1, const std::uint8_t* in2, const std::uint8_t* secret ) noexcept
+   {
+      acc.low += xxh3_mix16_impl( in1, secret );
+      acc.low ^= xxh3_read64_impl( in2 ) + xxh3_read64_impl( in2 + 8 );
+      acc.high += xxh3_mix16_impl( in2, secret + 16 );
+      acc.high ^= xxh3_read64_impl( in1 ) + xxh3_read64_impl( in1 + 8 );
+   }
+
+   [[nodiscard]] inline xxh3_128_impl xxh3_short_impl( const std::uint8_t* in, const std::size_t len ) noexcept
+   {
+      const std::uint8_t* const secret = xxh3_secret_impl;
+
+      if( len > 8 ) {
+         const std::uint64_t flipl = xxh3_read64_impl( secret + 32 ) ^ xxh3_read64_impl( secret + 40 );
+         const std::uint64_t fliph = xxh3_read64_impl( secret + 48 ) ^ xxh3_read64_impl( secret + 56 );
+         const std::uint64_t lo = xxh3_read64_impl( in );
+         std::uint64_t hi = xxh3_read64_impl( in + len - 8 );
+         xxh3_128_impl m = xxh3_mul128_impl( lo ^ hi ^ flipl, xxh3_prime64_1 );
+         m.low += std::uint64_t( len - 1 ) << 54;
+         hi ^= fliph;
+         m.high += hi + std::uint64_t( std::uint32_t( hi ) ) * ( xxh3_prime32_2 - 1 );
+         m.low ^= xxh3_swap64_impl( m.high );
+         xxh3_128_impl h = xxh3_mul128_impl( m.low, xxh3_prime64_2 );
+         h.high += m.high * xxh3_prime64_2;
+         return { xxh3_avalanche_impl( h.low ), xxh3_avalanche_impl( h.high ) };
+      }
+      if( len >= 4 ) {
+         const std::uint64_t in64 = xxh3_read32_impl( in ) + ( std::uint64_t( xxh3_read32_impl( in + len - 4 ) ) << 32 );
+         const std::uint64_t flip = xxh3_read64_impl( secret + 16 ) ^ xxh3_read64_impl( secret + 24 );
+         xxh3_128_impl m = xxh3_mul128_impl( in64 ^ flip, xxh3_prime64_1 + ( len << 2 ) );
+         m.high += m.low << 1;
+         m.low ^= m.high >> 3;
+         m.low ^= m.low >> 35;
+         m.low *= xxh3_prime_mx2;
+         m.low ^= m.low >> 28;
+         return { m.low, xxh3_avalanche_impl( m.high ) };
+      }
+      if( len > 0 ) {
+         const std::uint32_t c1 = in[ 0 ];
+         const std::uint32_t c2 = in[ len >> 1 ];
+         const std::uint32_t c3 = in[ len - 1 ];
+         const std::uint32_t combinedl = ( c1 << 16 ) | ( c2 << 24 ) | c3 | ( std::uint32_t( len ) << 8 );
+         const std::uint32_t combinedh = std::rotl( xxh3_swap32_impl( combinedl ), 13 );
+         const std::uint64_t flipl = xxh3_read32_impl( secret ) ^ xxh3_read32_impl( secret + 4 );
+         const std::uint64_t fliph = xxh3_read32_impl( secret + 8 ) ^ xxh3_read32_impl( secret + 12 );
+         return { xxh3_xxh64_avalanche_impl( combinedl ^ flipl ), xxh3_xxh64_avalanche_impl( combinedh ^ fliph ) };
+      }
+      return { xxh3_xxh64_avalanche_impl( xxh3_read64_impl( secret + 64 ) ^ xxh3_read64_impl( secret + 72 ) ), xxh3_xxh64_avalanche_impl( xxh3_read64_impl( secret + 80 ) ^ xxh3_read64_impl( secret + 88 ) ) };
+   }
+
+   [[nodiscard]] inline xxh3_128_impl xxh3_medium_impl( const std::uint8_t* in, const std::size_t len ) noexcept
+   {
+      const std::uint8_t* const secret = xxh3_secret_impl;
+
+      xxh3_128_impl acc = { len * xxh3_prime64_1, 0 };
+
+      if( len <= 128 ) {
+         if( len > 32 ) {
+            if( len > 64 ) {
+               if( len > 96 ) {
+                  xxh3_mix32_impl( acc, in + 48, in + len - 64, secret + 96 );
+               }
+               xxh3_mix32_impl( acc, in + 32, in + len - 48, secret + 64 );
+            }
+            xxh3_mix32_impl( acc, in + 16, in + len - 32, secret + 32 );
+         }
+         xxh3_mix32_impl( acc, in, in + len - 16, secret );
+      }
+      else {
+         const std::size_t rounds = len / 32;
+
+         for( std::size_t i = 0; i < 4; ++i ) {
+            xxh3_mix32_impl( acc, in + 32 * i, in + 32 * i + 16, secret + 32 * i );
+         }
+         acc.low = xxh3_avalanche_impl( acc.low );
+         acc.high = xxh3_avalanche_impl( acc.high );
+
+         for( std::size_t i = 4; i < rounds; ++i ) {
+            xxh3_mix32_impl( acc, in + 32 * i, in + 32 * i + 16, secret + 3 + 32 * ( i - 4 ) );
+         }
+         xxh3_mix32_impl( acc, in + len - 16, in + len - 32, secret + 136 - 17 - 16 );
+      }
+      const std::uint64_t low = acc.low + acc.high;
+      const std::uint64_t high = ( acc.low * xxh3_prime64_1 ) + ( acc.high * xxh3_prime64_4 ) + ( len * xxh3_prime64_2 );
+      return { xxh3_avalanche_impl( low ), std::uint64_t( 0 ) - xxh3_avalanche_impl( high ) };
+   }
+
+   inline void xxh3_accumulate_impl( std::uint64_t* acc, const std::uint8_t* in, const std::uint8_t* secret ) noexcept
+   {
+      for( unsigned i = 0; i < 8; ++i ) {
+         const std::uint64_t value = xxh3_read64_impl( in + 8 * i );
+         const std::uint64_t key = value ^ xxh3_read64_impl( secret + 8 * i );
+         acc[ i ^ 1 ] += value;
+         acc[ i ] += ( key & 0xffffffffULL ) * ( key >> 32 );
+      }
+   }
+
+   inline void xxh3_scramble_impl( std::uint64_t* acc ) noexcept
+   {
+      const std::uint8_t* const secret = xxh3_secret_impl + xxh3_secret_size - xxh3_stripe_size;
+
+      for( unsigned i = 0; i < 8; ++i ) {
+         std::uint64_t a = acc[ i ];
+         a ^= a >> 47;
+         a ^= xxh3_read64_impl( secret + 8 * i );
+         a *= xxh3_prime32_1;
+         acc[ i ] = a;
+      }
+   }
+
+   [[nodiscard]] inline std::uint64_t xxh3_merge_impl( const std::uint64_t* acc, const std::uint8_t* secret, std::uint64_t result ) noexcept
+   {
+      for( unsigned i = 0; i < 4; ++i ) {
+         result += xxh3_fold64_impl( acc[ 2 * i ] ^ xxh3_read64_impl( secret + 16 * i ), acc[ 2 * i + 1 ] ^ xxh3_read64_impl( secret + 16 * i + 8 ) );
+      }
+      return xxh3_avalanche_impl( result );
+   }
+
+   inline xxh3::xxh3() noexcept
+      : m_acc{ xxh3_prime32_3, xxh3_prime64_1, xxh3_prime64_2, xxh3_prime64_3, xxh3_prime64_4, xxh3_prime32_2, xxh3_prime64_5, xxh3_prime32_1 }
+   {}
+
+   // Consumes the given number of stripes, scrambling the accumulators at the end of every block.
+
+   inline void xxh3::consume( const std::uint8_t* in, std::size_t stripes )
+   {
+      while( stripes > 0 ) {
+         const std::size_t n = std::min( stripes, xxh3_stripes_per_block - m_stripes );
+
+         for( std::size_t i = 0; i < n; ++i ) {
+            xxh3_accumulate_impl( m_acc, in + i * xxh3_stripe_size, xxh3_secret_impl + ( m_stripes + i ) * 8 );
+         }
+         in += n * xxh3_stripe_size;
+         stripes -= n;
+         m_stripes += n;
+
+         if( m_stripes == xxh3_stripes_per_block ) {
+            xxh3_scramble_impl( m_acc );
+            m_stripes = 0;
+         }
+      }
+   }
+
+   inline void xxh3::updatev( const std::uint8_t* data, std::size_t size )
+   {
+      m_length += size;
+
+      if( m_buffered + size <= xxh3_buffer_size ) {
+         std::memcpy( m_buffer + m_buffered, data, size );
+         m_buffered += size;
+         return;
+      }
+      // The buffer is only consumed when more data follows, and it always
+      // keeps the last stripe that was consumed at the end of the buffer.
+
+      if( m_buffered > 0 ) {
+         const std::size_t n = xxh3_buffer_size - m_buffered;
+         std::memcpy( m_buffer + m_buffered, data, n );
+         data += n;
+         size -= n;
+         consume( m_buffer, xxh3_buffer_size / xxh3_stripe_size );
+         m_buffered = 0;
+      }
+      if( size > xxh3_buffer_size ) {
+         const std::size_t stripes = ( size - 1 ) / xxh3_stripe_size;
+         consume( data, stripes );
+         data += stripes * xxh3_stripe_size;
+         size -= stripes * xxh3_stripe_size;
+         std::memcpy( m_buffer + xxh3_buffer_size - xxh3_stripe_size, data - xxh3_stripe_size, xxh3_stripe_size );
+      }
+      std::memcpy( m_buffer, data, size );
+      m_buffered = size;
+   }
+
+   inline void xxh3::finalisev( std::uint8_t* digest )
+   {
+      xxh3_128_impl h;
+
+      if( m_length <= 16 ) {
+         h = xxh3_short_impl( m_buffer, m_length );
+      }
+      else if( m_length <= 240 ) {
+         h = xxh3_medium_impl( m_buffer, m_length );
+      }
+      else {
+         std::uint64_t acc[ 8 ];
+         std::memcpy( acc, m_acc, sizeof( acc ) );
+         const std::size_t stripes = m_stripes;
+
+         std::uint8_t last[ xxh3_stripe_size ];
+
+         if( m_buffered >= xxh3_stripe_size ) {
+            consume( m_buffer, ( m_buffered - 1 ) / xxh3_stripe_size );
+            std::memcpy( last, m_buffer + m_buffered - xxh3_stripe_size, xxh3_stripe_size );
+         }
+         else {
+            const std::size_t n = xxh3_stripe_size - m_buffered;
+            std::memcpy( last, m_buffer + xxh3_buffer_size - n, n );
+            std::memcpy( last + n, m_buffer, m_buffered );
+         }
+         xxh3_accumulate_impl( m_acc, last, xxh3_secret_impl + xxh3_secret_size - xxh3_stripe_size - 7 );
+
+         h.low = xxh3_merge_impl( m_acc, xxh3_secret_impl + 11, m_length * xxh3_prime64_1 );
+         h.high = xxh3_merge_impl( m_acc, xxh3_secret_impl + xxh3_secret_size - 64 - 11, ~( m_length * xxh3_prime64_2 ) );
+
+         std::memcpy( m_acc, acc, sizeof( acc ) );
+         m_stripes = stripes;
+      }
+      for( unsigned i = 0; i < 8; ++i ) {
+         digest[ i ] = std::uint8_t( h.high >> ( 56 - 8 * i ) );
+         digest[ 8 + i ] = std::uint8_t( h.low >> ( 56 - 8 * i ) );
+      }
+   }
+
+}  // namespace filez